@@ -39,6 +39,10 @@
 #include <rtt/types/PropertyDecomposition.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <set>
+
 #include <iostream>
 #include <fstream>
 
@@ -54,12 +58,42 @@ using namespace RTT::detail;
 IntrospectionReporter::IntrospectionReporter(std::string name) : TaskContext(name),
                                                                  in_current_flow(RTT::NoData),
                                                                  storage_size(500000),
-                                                                 report_policy(ConnPolicy::data(ConnPolicy::LOCK_FREE, true, false))
+                                                                 folded_stack_file("rtReport.folded"),
+                                                                 corrected_durations_file("rtReport.durations.csv"),
+                                                                 perf_storage_size(100000),
+                                                                 perf_counters_file("rtReport.perf.csv"),
+                                                                 cpu_timeline_file("rtReport.cpu.csv"),
+                                                                 cpu_utilization_file("rtReport.cpu_utilization.csv"),
+                                                                 summary_storage_size(100000),
+                                                                 summary_file("rtReport.summary.csv"),
+                                                                 causal_storage_size(100000),
+                                                                 causal_latency_file("rtReport.causal.csv"),
+                                                                 report_policy(ConnPolicy::data(ConnPolicy::LOCK_FREE, true, false)),
+                                                                 loss_report_file("rtReport.loss.csv"),
+                                                                 lock_memory(false)
 {
+    this->addProperty("lock_memory", lock_memory).doc("Prefault and mlock the sample storages in configureHook, so that storing samples never page-faults (needs a sufficient RLIMIT_MEMLOCK).");
+    this->addProperty("loss_report_file", loss_report_file).doc("CSV file for the produced, dropped, overwritten and stored call trace events per component written in stopHook, empty to disable.");
     this->addProperty("storage_size", storage_size);
+    this->addProperty("perf_storage_size", perf_storage_size).doc("Number of perf counter samples stored per component.");
+    this->addProperty("perf_counters_file", perf_counters_file).doc("CSV file for the perf counter deltas of the updateHook() calls written in stopHook, empty to disable.");
+    this->addProperty("cpu_timeline_file", cpu_timeline_file).doc("CSV file for the updateHook() intervals per cpu written in stopHook, empty to disable.");
+    this->addProperty("cpu_utilization_file", cpu_utilization_file).doc("CSV file for the busy time, utilization and overlap per cpu written in stopHook, empty to disable.");
+    this->addProperty("summary_storage_size", summary_storage_size).doc("Number of summary records stored per component.");
+    this->addProperty("summary_file", summary_file).doc("CSV file for the per port and hook summaries of the components in summary mode written in stopHook, empty to disable.");
+    this->addProperty("causal_storage_size", causal_storage_size).doc("Number of causal hop samples stored of all components.");
+    this->addProperty("causal_latency_file", causal_latency_file).doc("CSV file for the hop and end-to-end latency distributions (ns) of the causal chains written in stopHook, empty to disable.");
+    this->addProperty("corrected_durations_file", corrected_durations_file).doc("CSV file for the raw and tracing overhead-corrected durations (ns) written in stopHook, empty to disable.");
+    this->addProperty("folded_stack_file", folded_stack_file).doc("File for the folded call stacks (flamegraph.pl input) written in stopHook, empty to disable.");
     ctsamples_storage.reserve(storage_size);
 }
 
+IntrospectionReporter::~IntrospectionReporter()
+{
+    // the blocks live in the pools of the producers
+    releaseBlocks();
+}
+
 bool IntrospectionReporter::configureHook()
 {
     for (std::string peerName : this->getPeerList())
@@ -77,7 +111,53 @@ bool IntrospectionReporter::configureHook()
             // Couldn't find IF!
             continue;
         }
-        RTT::base::PortInterface *pi = intro_srv->getPort("out_call_trace_sample_vec_port");
+        RTT::base::PortInterface *pi = intro_srv->getPort("out_call_trace_block_port");
+        if (pi)
+        {
+            RTT::base::OutputPortInterface *portB = dynamic_cast<RTT::base::OutputPortInterface *>(pi);
+            std::shared_ptr<RTT::InputPort<cogimon::CallTraceBlock *>> ipb(new RTT::InputPort<cogimon::CallTraceBlock *>("in_" + peerName + "_block_port"));
+            this->ports()->addEventPort(*ipb.get());
+            // every block pointer has to arrive, otherwise the block is never returned to the pool
+            if (portB && portB->connectTo(ipb.get(), ConnPolicy::buffer(cogimon::RTTIntrospectionBlockPool::MAX_BLOCKS, ConnPolicy::LOCK_FREE)))
+            {
+                log(Info) << "Receiving call trace blocks of Component " << peerName << " by pointer." << endlog();
+                in_ctblock_ports.push_back(ipb);
+                ctblock_containers.push_back(peerName);
+                connectAuxiliaryPorts(peerName, intro_srv);
+                continue;
+            }
+            log(Warning) << "Could not connect to OutputPort " << pi->getName() << ", falling back to out_call_trace_record_port." << endlog();
+            this->ports()->removePort(ipb->getName());
+        }
+
+        pi = intro_srv->getPort("out_call_trace_record_port");
+        RTT::base::PortInterface *pn = intro_srv->getPort("out_call_name_table_port");
+        if (pi && pn)
+        {
+            RTT::base::OutputPortInterface *portR = dynamic_cast<RTT::base::OutputPortInterface *>(pi);
+            RTT::base::OutputPortInterface *portN = dynamic_cast<RTT::base::OutputPortInterface *>(pn);
+            std::shared_ptr<RTT::InputPort<std::vector<cogimon::CallTraceRecord>>> ipr(new RTT::InputPort<std::vector<cogimon::CallTraceRecord>>("in_" + peerName + "_record_port"));
+            std::shared_ptr<RTT::InputPort<std::vector<std::string>>> ipn(new RTT::InputPort<std::vector<std::string>>("in_" + peerName + "_name_table_port"));
+            this->ports()->addEventPort(*ipr.get());
+            this->ports()->addPort(*ipn.get());
+            // the name table is written once in configureHook, so take over the last written value
+            if (portR && portN && portN->connectTo(ipn.get(), ConnPolicy::data(ConnPolicy::LOCK_FREE, true, false)) && portR->connectTo(ipr.get(), report_policy))
+            {
+                log(Info) << "Receiving call trace records of Component " << peerName << "." << endlog();
+                in_ctrecord_ports.push_back(ipr);
+                ctrecord_containers.push_back(peerName);
+                in_ctname_ports.push_back(ipn);
+                call_name_tables.push_back(std::vector<std::string>());
+                connectAuxiliaryPorts(peerName, intro_srv);
+                continue;
+            }
+            log(Warning) << "Could not connect to OutputPort " << pi->getName() << ", falling back to out_call_trace_sample_vec_port." << endlog();
+            ipn->disconnect();
+            this->ports()->removePort(ipr->getName());
+            this->ports()->removePort(ipn->getName());
+        }
+
+        pi = intro_srv->getPort("out_call_trace_sample_vec_port");
         if (!pi)
         {
             // Couldn't find port!
@@ -111,6 +191,8 @@ bool IntrospectionReporter::configureHook()
             continue;
         }
         in_ctsamples_ports.push_back(ipi);
+        ctsamples_containers.push_back(peerName);
+        connectAuxiliaryPorts(peerName, intro_srv);
     }
 
     // RTT::log(RTT::Error) << "PORTS: " << in_ctsamples_ports.size() << RTT::endlog();
@@ -119,9 +201,41 @@ bool IntrospectionReporter::configureHook()
     {
         port->clear();
     }
+    if (!in_ctrecord_ports.empty())
+    {
+        ctrecords_storage.reserve(storage_size);
+    }
+    if (lock_memory)
+    {
+        lockStorageMemory();
+    }
     return true;
 }
 
+void IntrospectionReporter::lockStorageMemory()
+{
+    storage_memory.unlock();
+    storage_memory.lock(ctsamples_storage);
+    storage_memory.lock(ctrecords_storage);
+    for (const std::vector<cogimon::CallTracePerfSample> &storage : perf_storages)
+    {
+        storage_memory.lock(storage);
+    }
+    for (const std::vector<cogimon::CallTraceSummaryRecord> &storage : summary_storages)
+    {
+        storage_memory.lock(storage);
+    }
+    storage_memory.lock(causal_storage);
+    if (storage_memory.getError() != 0)
+    {
+        log(Warning) << "Could only lock " << storage_memory.getLocked() / 1024 << " of " << storage_memory.getPrefaulted() / 1024 << " KiB of sample storage (" << std::strerror(storage_memory.getError()) << "), the rest is prefaulted. Consider raising RLIMIT_MEMLOCK." << endlog();
+    }
+    else
+    {
+        log(Info) << "Locked " << storage_memory.getLocked() / 1024 << " KiB of sample storage." << endlog();
+    }
+}
+
 bool IntrospectionReporter::startHook()
 {
     // clean all ports
@@ -132,41 +246,821 @@ bool IntrospectionReporter::startHook()
     return true;
 }
 
-void IntrospectionReporter::updateHook()
+void IntrospectionReporter::consumeBlock(cogimon::CallTraceBlock *block, cogimon::CallTraceLoss &loss)
 {
-    log(Debug) << "Logger updateHook " << endlog();
-    if (!this->isConfigured() || ctsamples_storage.size() == ctsamples_storage.capacity())
+    // the events are read in place, this is the only copy on the way from the producer
+    std::size_t i = 0;
+    for (; i < block->size && ctsamples_storage.size() < ctsamples_storage.capacity(); i++)
     {
-        log(Error) << "Logger abort due to initial if (!this->isConfigured() || ctsamples_storage.size() == ctsamples_storage.capacity())" << endlog();
+        const cogimon::CallTraceEvent &cte = block->events[i];
+        // same as the vector port batches: each block starts with the sampling factor and carries a new marker whenever it changes
+        if (i == 0 || cte.sampling_factor != block->events[i - 1].sampling_factor)
+        {
+            ctsamples_storage.push_back(rstrt::monitoring::CallTraceSample());
+            block->toSamplingFactorSample(cte, ctsamples_storage.back());
+            if (ctsamples_storage.size() == ctsamples_storage.capacity())
+            {
+                break;
+            }
+        }
+        ctsamples_storage.push_back(rstrt::monitoring::CallTraceSample());
+        block->toCallTraceSample(cte, ctsamples_storage.back());
+    }
+    loss.addBatch(block->sequence, block->size, i);
+    block->release();
+}
+
+void IntrospectionReporter::storeSamples(cogimon::CallTraceLoss &loss)
+{
+    std::vector<rstrt::monitoring::CallTraceSample>::const_iterator begin = in_current_var.begin();
+    uint_least64_t sequence = 0;
+    if (begin != in_current_var.end() && begin->call_name == cogimon::BATCH_SEQUENCE_NAME)
+    {
+        sequence = static_cast<uint_least64_t>(begin->call_duration);
+        ++begin;
+    }
+    const std::size_t elements = std::min(static_cast<std::size_t>(in_current_var.end() - begin), ctsamples_storage.capacity() - ctsamples_storage.size());
+    // the sampling factor markers are no events
+    uint_least64_t events = 0;
+    uint_least64_t stored = 0;
+    for (std::vector<rstrt::monitoring::CallTraceSample>::const_iterator it = begin; it != in_current_var.end(); ++it)
+    {
+        if (it->call_name != cogimon::SAMPLING_FACTOR_NAME)
+        {
+            events++;
+            stored += static_cast<std::size_t>(it - begin) < elements ? 1 : 0;
+        }
+    }
+    ctsamples_storage.insert(ctsamples_storage.end(), begin, begin + elements);
+    if (sequence > 0)
+    {
+        loss.addBatch(sequence, events, stored);
+    }
+}
+
+void IntrospectionReporter::connectAccounting(const std::string &peerName, Service::shared_ptr intro_srv)
+{
+    RTT::base::OutputPortInterface *accounting_port = dynamic_cast<RTT::base::OutputPortInterface *>(intro_srv->getPort("out_call_trace_accounting_port"));
+    if (!accounting_port)
+    {
+        return;
+    }
+    std::shared_ptr<RTT::InputPort<Eigen::VectorXd>> ipa(new RTT::InputPort<Eigen::VectorXd>("in_" + peerName + "_accounting_port"));
+    this->ports()->addPort(*ipa.get());
+    // only the latest counters matter
+    if (!accounting_port->connectTo(ipa.get(), ConnPolicy::data(ConnPolicy::LOCK_FREE, true, false)))
+    {
+        log(Warning) << "Could not connect to the call trace accounting of Component " << peerName << endlog();
+        this->ports()->removePort(ipa->getName());
         return;
     }
+    in_accounting_ports.push_back(ipa);
+    accounting_containers.push_back(peerName);
+}
 
-    for (std::shared_ptr<RTT::InputPort<std::vector<rstrt::monitoring::CallTraceSample>>> port : in_ctsamples_ports)
+void IntrospectionReporter::writeLossReport(const std::string &file_name)
+{
+    ofstream myfile;
+    if (!file_name.empty())
     {
-        in_current_flow = port->read(in_current_var);
-        log(Debug) << "for each port " << port->getName() << " read: " << in_current_flow << endlog();
-        if (in_current_flow == RTT::NewData)
+        myfile.open(file_name.c_str());
+        myfile << "container_name,produced,dropped_producer,sent,overwritten,received,dropped_reporter,stored,batches,missing_batches,loss\n";
+    }
+    for (std::size_t i = 0; i < in_accounting_ports.size(); i++)
+    {
+        Eigen::VectorXd counters;
+        if (in_accounting_ports[i]->read(counters) == RTT::NoData || counters.size() != cogimon::ACCOUNTING_SIZE)
+        {
+            continue;
+        }
+        const cogimon::CallTraceLoss &loss = call_trace_losses[accounting_containers[i]];
+        const uint_least64_t produced = static_cast<uint_least64_t>(counters(cogimon::ACCOUNTING_PRODUCED));
+        const uint_least64_t dropped = static_cast<uint_least64_t>(counters(cogimon::ACCOUNTING_DROPPED));
+        const uint_least64_t sent = static_cast<uint_least64_t>(counters(cogimon::ACCOUNTING_SENT));
+        // sent but never received, e.g. overwritten by a newer batch in a data connection
+        const uint_least64_t overwritten = sent > loss.received ? sent - loss.received : 0;
+        const uint_least64_t dropped_reporter = loss.received - loss.stored;
+        // produced but not stored here, including what was never sent
+        const double loss_ratio = produced > 0 ? static_cast<double>(produced - std::min(produced, loss.stored)) / produced : 0.0;
+        if (myfile.is_open())
+        {
+            myfile << accounting_containers[i] << "," << produced << "," << dropped << "," << sent << "," << overwritten << "," << loss.received << "," << dropped_reporter << "," << loss.stored << "," << loss.batches << "," << loss.missing_batches << "," << loss_ratio << "\n";
+        }
+        RTT::log(loss_ratio > 0 ? RTT::Warning : RTT::Info) << "Component " << accounting_containers[i] << ": " << produced << " call trace events produced, " << dropped << " dropped by the component, " << overwritten << " overwritten (" << loss.missing_batches << " batches), " << dropped_reporter << " dropped by the reporter, " << loss_ratio * 100.0 << "% lost." << RTT::endlog();
+    }
+    if (myfile.is_open())
+    {
+        myfile.close();
+    }
+}
+
+void IntrospectionReporter::connectFlushHandshake(const std::string &peerName, Service::shared_ptr intro_srv)
+{
+    RTT::base::OutputPortInterface *flush_port = dynamic_cast<RTT::base::OutputPortInterface *>(intro_srv->getPort("out_call_trace_flush_port"));
+    RTT::base::InputPortInterface *ack_port = dynamic_cast<RTT::base::InputPortInterface *>(intro_srv->getPort("in_call_trace_flush_ack_port"));
+    if (!flush_port || !ack_port)
+    {
+        log(Info) << "Component " << peerName << " does not support flushing, its last samples may get lost on stop." << endlog();
+        return;
+    }
+    std::shared_ptr<RTT::InputPort<uint_least64_t>> ipf(new RTT::InputPort<uint_least64_t>("in_" + peerName + "_flush_port"));
+    std::shared_ptr<RTT::OutputPort<uint_least64_t>> opa(new RTT::OutputPort<uint_least64_t>("out_" + peerName + "_flush_ack_port"));
+    this->ports()->addEventPort(*ipf.get());
+    this->ports()->addPort(*opa.get());
+    if (!flush_port->connectTo(ipf.get(), ConnPolicy::data(ConnPolicy::LOCK_FREE, false, false)) || !opa->connectTo(ack_port, ConnPolicy::data(ConnPolicy::LOCK_FREE, false, false)))
+    {
+        log(Warning) << "Could not connect the flush handshake of Component " << peerName << endlog();
+        ipf->disconnect();
+        opa->disconnect();
+        this->ports()->removePort(ipf->getName());
+        this->ports()->removePort(opa->getName());
+        return;
+    }
+    in_flush_ports.push_back(ipf);
+    out_flush_ack_ports.push_back(opa);
+    flush_requests.push_back(0);
+}
+
+void IntrospectionReporter::readFlushRequests()
+{
+    uint_least64_t flush_id = 0;
+    for (std::size_t i = 0; i < in_flush_ports.size(); i++)
+    {
+        if (in_flush_ports[i]->read(flush_id, false) == RTT::NewData)
         {
-            if ((ctsamples_storage.size() + in_current_var.size()) <= ctsamples_storage.capacity())
+            flush_requests[i] = flush_id;
+        }
+    }
+}
+
+void IntrospectionReporter::acknowledgeFlushRequests()
+{
+    for (std::size_t i = 0; i < flush_requests.size(); i++)
+    {
+        if (flush_requests[i] > 0)
+        {
+            out_flush_ack_ports[i]->write(flush_requests[i]);
+            flush_requests[i] = 0;
+        }
+    }
+}
+
+void IntrospectionReporter::readRecords()
+{
+    for (std::size_t i = 0; i < in_ctrecord_ports.size(); i++)
+    {
+        // does not copy if nothing changed
+        in_ctname_ports[i]->read(call_name_tables[i], false);
+        if (in_ctrecord_ports[i]->read(in_current_records, false) != RTT::NewData || in_current_records.empty())
+        {
+            continue;
+        }
+        call_name_table_index[in_current_records.front().component_id] = i;
+        std::vector<cogimon::CallTraceRecord>::const_iterator begin = in_current_records.begin();
+        uint_least64_t sequence = 0;
+        if (begin->flags & cogimon::CallTraceRecord::FLAG_BATCH_SEQUENCE)
+        {
+            sequence = begin->call_time;
+            ++begin;
+        }
+        const std::size_t events = in_current_records.end() - begin;
+        std::size_t elements = events;
+        if (ctrecords_storage.size() + elements > ctrecords_storage.capacity())
+        {
+            elements = ctrecords_storage.capacity() - ctrecords_storage.size();
+        }
+        ctrecords_storage.insert(ctrecords_storage.end(), begin, begin + elements);
+        if (sequence > 0)
+        {
+            call_trace_losses[ctrecord_containers[i]].addBatch(sequence, events, elements);
+        }
+    }
+}
+
+void IntrospectionReporter::writeRecords(std::ostream &out, bool &first)
+{
+    static const std::vector<std::string> no_names;
+    // sampling factor of the last record per component, a marker is written whenever it changes
+    std::map<uint16_t, uint32_t> sampling_factors;
+    rstrt::monitoring::CallTraceSample cts;
+    for (const cogimon::CallTraceRecord &record : ctrecords_storage)
+    {
+        std::map<uint16_t, std::size_t>::const_iterator table = call_name_table_index.find(record.component_id);
+        const std::vector<std::string> &names = table != call_name_table_index.end() ? call_name_tables[table->second] : no_names;
+        std::map<uint16_t, uint32_t>::iterator factor = sampling_factors.find(record.component_id);
+        if (factor == sampling_factors.end() || factor->second != record.sampling_factor)
+        {
+            sampling_factors[record.component_id] = record.sampling_factor;
+            cogimon::toCallTraceSample(record, names, cts);
+            cts.call_name = cogimon::SAMPLING_FACTOR_NAME;
+            cts.call_duration = record.sampling_factor;
+            cts.call_type = rstrt::monitoring::CallTraceSample::CALL_UNIVERSAL;
+            out << (first ? "" : ",\n") << cts;
+            first = false;
+        }
+        cogimon::toCallTraceSample(record, names, cts);
+        out << (first ? "" : ",\n") << cts;
+        first = false;
+    }
+}
+
+bool IntrospectionReporter::TraceInterval::operator<(const TraceInterval &other) const
+{
+    if (start != other.start)
+    {
+        return start < other.start;
+    }
+    if (end != other.end)
+    {
+        return end > other.end;
+    }
+    return depth < other.depth;
+}
+
+namespace
+{
+struct TraceFrame
+{
+    double end;
+    double self;
+    uint32_t sampling_factor;
+    std::string stack;
+};
+
+// the deadline miss covers the same interval as the updateHook it belongs to,
+// a trigger sample starts before the updateHook it woke up and is no call of the component
+bool isTraceInterval(const std::string &call_name)
+{
+    return call_name != cogimon::DEADLINE_MISS_NAME && call_name != cogimon::SAMPLING_FACTOR_NAME
+        && call_name.compare(0, std::strlen(cogimon::TRIGGER_NAME_PREFIX), cogimon::TRIGGER_NAME_PREFIX) != 0;
+}
+} // namespace
+
+void IntrospectionReporter::collectTraces(std::map<std::string, ContainerTrace> &traces) const
+{
+    std::map<std::string, uint32_t> sampling_factors;
+    for (const rstrt::monitoring::CallTraceSample &cts : ctsamples_storage)
+    {
+        if (cts.call_name == cogimon::SAMPLING_FACTOR_NAME)
+        {
+            sampling_factors[cts.container_name] = static_cast<uint32_t>(cts.call_duration);
+            continue;
+        }
+        ContainerTrace &trace = traces[cts.container_name];
+        trace.event_times.push_back(cts.call_time);
+        if (cts.call_type == rstrt::monitoring::CallTraceSample::CALL_START_WITH_DURATION && cts.call_duration > cts.call_time && isTraceInterval(cts.call_name))
+        {
+            std::map<std::string, uint32_t>::const_iterator factor = sampling_factors.find(cts.container_name);
+            TraceInterval interval = {cts.call_time, cts.call_duration, factor != sampling_factors.end() ? factor->second : 1, 0, &cts.call_name};
+            trace.intervals.push_back(interval);
+        }
+    }
+    for (const cogimon::CallTraceRecord &record : ctrecords_storage)
+    {
+        std::map<uint16_t, std::size_t>::const_iterator table = call_name_table_index.find(record.component_id);
+        if (table == call_name_table_index.end() || call_name_tables[table->second].empty())
+        {
+            continue;
+        }
+        const std::vector<std::string> &names = call_name_tables[table->second];
+        ContainerTrace &trace = traces[names[cogimon::RTTIntrospectionNameRegistry::CONTAINER_ID]];
+        trace.event_times.push_back(static_cast<double>(record.call_time));
+        if (record.call_type == rstrt::monitoring::CallTraceSample::CALL_START_WITH_DURATION && record.call_duration > 0 && record.call_name_id < names.size() && isTraceInterval(names[record.call_name_id]))
+        {
+            TraceInterval interval = {static_cast<double>(record.call_time), static_cast<double>(record.call_time + record.call_duration), record.sampling_factor, record.depth, &names[record.call_name_id]};
+            trace.intervals.push_back(interval);
+        }
+    }
+    for (std::map<std::string, ContainerTrace>::iterator trace = traces.begin(); trace != traces.end(); ++trace)
+    {
+        std::sort(trace->second.intervals.begin(), trace->second.intervals.end());
+        std::sort(trace->second.event_times.begin(), trace->second.event_times.end());
+    }
+}
+
+void IntrospectionReporter::writeFoldedStacks(const std::string &file_name, const std::map<std::string, ContainerTrace> &traces)
+{
+    std::map<std::string, double> folded;
+    for (std::map<std::string, ContainerTrace>::const_iterator container = traces.begin(); container != traces.end(); ++container)
+    {
+        std::vector<TraceFrame> stack;
+        for (const TraceInterval &interval : container->second.intervals)
+        {
+            // close everything that does not contain this interval
+            while (!stack.empty() && (interval.start >= stack.back().end || interval.end > stack.back().end))
+            {
+                folded[stack.back().stack] += std::max(stack.back().self, 0.0) * stack.back().sampling_factor;
+                stack.pop_back();
+            }
+            if (!stack.empty())
+            {
+                stack.back().self -= interval.end - interval.start;
+            }
+            TraceFrame frame = {interval.end, interval.end - interval.start, interval.sampling_factor, (stack.empty() ? container->first : stack.back().stack) + ";" + *interval.call_name};
+            stack.push_back(frame);
+        }
+        while (!stack.empty())
+        {
+            folded[stack.back().stack] += std::max(stack.back().self, 0.0) * stack.back().sampling_factor;
+            stack.pop_back();
+        }
+    }
+
+    ofstream myfile;
+    myfile.open(file_name.c_str());
+    for (std::map<std::string, double>::const_iterator it = folded.begin(); it != folded.end(); ++it)
+    {
+        myfile << it->first << " " << static_cast<uint_least64_t>(it->second) << "\n";
+    }
+    myfile.close();
+    RTT::log(RTT::Warning) << "Finished writing " << folded.size() << " call stacks to " << file_name << RTT::endlog();
+}
+
+void IntrospectionReporter::writeCorrectedDurations(const std::string &file_name, const std::map<std::string, ContainerTrace> &traces)
+{
+    std::map<std::string, Eigen::VectorXd> models;
+    for (std::size_t i = 0; i < in_overhead_ports.size(); i++)
+    {
+        Eigen::VectorXd model;
+        if (in_overhead_ports[i]->read(model) != RTT::NoData && model.size() == cogimon::RTTIntrospectionOverheadModel::MODEL_SIZE)
+        {
+            models[overhead_containers[i]] = model;
+        }
+    }
+
+    ofstream myfile;
+    myfile.open(file_name.c_str());
+    myfile << "container_name,call_name,call_time,raw_duration,corrected_duration\n";
+    for (std::map<std::string, ContainerTrace>::const_iterator container = traces.begin(); container != traces.end(); ++container)
+    {
+        std::map<std::string, Eigen::VectorXd>::const_iterator model_it = models.find(container->first);
+        if (model_it == models.end())
+        {
+            log(Warning) << "No tracing overhead model of Component " << container->first << ", its durations are not corrected." << endlog();
+        }
+        const Eigen::VectorXd model = model_it != models.end() ? model_it->second : Eigen::VectorXd::Zero(cogimon::RTTIntrospectionOverheadModel::MODEL_SIZE);
+        const double timestamp = model(cogimon::RTTIntrospectionOverheadModel::MODEL_TIMESTAMP);
+        const double store = model(cogimon::RTTIntrospectionOverheadModel::MODEL_STORE);
+        const double flush = model(cogimon::RTTIntrospectionOverheadModel::MODEL_FLUSH);
+        const double events_per_flush = std::max(model(cogimon::RTTIntrospectionOverheadModel::MODEL_EVENTS_PER_FLUSH), 1.0);
+
+        const std::vector<TraceInterval> &intervals = container->second.intervals;
+        const std::vector<double> &event_times = container->second.event_times;
+        std::vector<double> interval_starts;
+        interval_starts.reserve(intervals.size());
+        for (const TraceInterval &interval : intervals)
+        {
+            interval_starts.push_back(interval.start);
+        }
+
+        // mean raw and corrected duration per call name, for the log
+        std::map<std::string, Eigen::Vector3d> means;
+        for (const TraceInterval &interval : intervals)
+        {
+            // everything that was traced inside the interval is part of its duration
+            const double events = std::upper_bound(event_times.begin(), event_times.end(), interval.end) - std::upper_bound(event_times.begin(), event_times.end(), interval.start);
+            const double nested = std::upper_bound(interval_starts.begin(), interval_starts.end(), interval.end) - std::upper_bound(interval_starts.begin(), interval_starts.end(), interval.start);
+            const double correction = events * (timestamp + store) + nested * timestamp + timestamp + events / events_per_flush * flush;
+            const double raw = interval.end - interval.start;
+            const double corrected = std::max(raw - correction, 0.0);
+            myfile << container->first << "," << *interval.call_name << "," << static_cast<uint_least64_t>(interval.start) << "," << static_cast<uint_least64_t>(raw) << "," << static_cast<uint_least64_t>(corrected) << "\n";
+
+            std::map<std::string, Eigen::Vector3d>::iterator mean = means.find(*interval.call_name);
+            if (mean == means.end())
             {
-                ctsamples_storage.insert(ctsamples_storage.end(), in_current_var.begin(), in_current_var.end());
+                mean = means.insert(std::make_pair(*interval.call_name, Eigen::Vector3d::Zero().eval())).first;
+            }
+            mean->second += Eigen::Vector3d(raw, corrected, 1.0);
+        }
+        for (std::map<std::string, Eigen::Vector3d>::const_iterator mean = means.begin(); mean != means.end(); ++mean)
+        {
+            log(Warning) << "[" << container->first << "] " << mean->first << " mean ns: raw " << mean->second(0) / mean->second(2) << ", corrected " << mean->second(1) / mean->second(2) << " (" << mean->second(2) << " samples)" << endlog();
+        }
+    }
+    myfile.close();
+    RTT::log(RTT::Warning) << "Finished writing to " << file_name << RTT::endlog();
+}
+
+void IntrospectionReporter::connectAuxiliaryPorts(const std::string &peerName, Service::shared_ptr intro_srv)
+{
+    connectFlushHandshake(peerName, intro_srv);
+    connectOverheadModel(peerName, intro_srv);
+    connectPerfCounters(peerName, intro_srv);
+    connectCausalTrace(peerName, intro_srv);
+    connectSummary(peerName, intro_srv);
+    connectAccounting(peerName, intro_srv);
+}
+
+void IntrospectionReporter::connectSummary(const std::string &peerName, Service::shared_ptr intro_srv)
+{
+    RTT::base::OutputPortInterface *summary_port = dynamic_cast<RTT::base::OutputPortInterface *>(intro_srv->getPort("out_call_trace_summary_port"));
+    RTT::base::OutputPortInterface *name_port = dynamic_cast<RTT::base::OutputPortInterface *>(intro_srv->getPort("out_call_name_table_port"));
+    if (!summary_port || !name_port)
+    {
+        return;
+    }
+    std::shared_ptr<RTT::InputPort<std::vector<cogimon::CallTraceSummaryRecord>>> ips(new RTT::InputPort<std::vector<cogimon::CallTraceSummaryRecord>>("in_" + peerName + "_summary_port"));
+    std::shared_ptr<RTT::InputPort<std::vector<std::string>>> ipn(new RTT::InputPort<std::vector<std::string>>("in_" + peerName + "_summary_name_table_port"));
+    this->ports()->addEventPort(*ips.get());
+    this->ports()->addPort(*ipn.get());
+    // the name table is written once in configureHook, so take over the last written value
+    if (!name_port->connectTo(ipn.get(), ConnPolicy::data(ConnPolicy::LOCK_FREE, true, false)) || !summary_port->connectTo(ips.get(), ConnPolicy::buffer(64, ConnPolicy::LOCK_FREE)))
+    {
+        log(Warning) << "Could not connect to the summaries of Component " << peerName << endlog();
+        ipn->disconnect();
+        this->ports()->removePort(ips->getName());
+        this->ports()->removePort(ipn->getName());
+        return;
+    }
+    in_summary_ports.push_back(ips);
+    in_summary_name_ports.push_back(ipn);
+    summary_containers.push_back(peerName);
+    summary_name_tables.push_back(std::vector<std::string>());
+    summary_storages.push_back(std::vector<cogimon::CallTraceSummaryRecord>());
+    summary_storages.back().reserve(summary_storage_size);
+}
+
+void IntrospectionReporter::readSummaries()
+{
+    for (std::size_t i = 0; i < in_summary_ports.size(); i++)
+    {
+        // does not copy if nothing changed
+        in_summary_name_ports[i]->read(summary_name_tables[i], false);
+        while (in_summary_ports[i]->read(in_current_summary, false) == RTT::NewData)
+        {
+            std::vector<cogimon::CallTraceSummaryRecord> &storage = summary_storages[i];
+            const std::size_t elements = std::min(in_current_summary.size(), storage.capacity() - storage.size());
+            storage.insert(storage.end(), in_current_summary.begin(), in_current_summary.begin() + elements);
+        }
+    }
+}
+
+void IntrospectionReporter::writeSummaries(const std::string &file_name)
+{
+    ofstream myfile;
+    myfile.open(file_name.c_str());
+    myfile << "container_name,call_name,start_time,end_time,calls,reads_new_data,reads_old_data,reads_no_data,writes,durations,duration_sum,duration_min,duration_max,duration_mean\n";
+    for (std::size_t i = 0; i < summary_storages.size(); i++)
+    {
+        const std::vector<std::string> &names = summary_name_tables[i];
+        for (const cogimon::CallTraceSummaryRecord &record : summary_storages[i])
+        {
+            myfile << summary_containers[i] << "," << (record.call_name_id < names.size() ? names[record.call_name_id] : "<unknown>") << "," << record.start_time << "," << record.end_time << "," << record.calls;
+            myfile << "," << record.reads_new_data << "," << record.reads_old_data << "," << record.reads_no_data << "," << record.writes;
+            // empty if the name has no durations (ports)
+            myfile << "," << record.durations << ",";
+            if (record.durations > 0)
+            {
+                myfile << record.duration_sum << "," << record.duration_min << "," << record.duration_max << "," << record.duration_sum / record.durations;
             }
             else
             {
-                // testing TODO
-                uint elements_left = ctsamples_storage.capacity() - ctsamples_storage.size();
-                for (unsigned i = 0; i < elements_left; i++)
+                myfile << ",,,";
+            }
+            myfile << "\n";
+        }
+    }
+    myfile.close();
+    RTT::log(RTT::Warning) << "Finished writing to " << file_name << RTT::endlog();
+}
+
+void IntrospectionReporter::connectCausalTrace(const std::string &peerName, Service::shared_ptr intro_srv)
+{
+    RTT::base::OutputPortInterface *causal_port = dynamic_cast<RTT::base::OutputPortInterface *>(intro_srv->getPort("out_causal_trace_port"));
+    if (!causal_port)
+    {
+        return;
+    }
+    std::shared_ptr<RTT::InputPort<std::vector<cogimon::CallTraceCausalSample>>> ipc(new RTT::InputPort<std::vector<cogimon::CallTraceCausalSample>>("in_" + peerName + "_causal_port"));
+    this->ports()->addEventPort(*ipc.get());
+    if (!causal_port->connectTo(ipc.get(), ConnPolicy::buffer(64, ConnPolicy::LOCK_FREE)))
+    {
+        log(Warning) << "Could not connect to the causal trace of Component " << peerName << endlog();
+        this->ports()->removePort(ipc->getName());
+        return;
+    }
+    in_causal_ports.push_back(ipc);
+    causal_storage.reserve(causal_storage_size);
+}
+
+void IntrospectionReporter::readCausalSamples()
+{
+    for (std::size_t i = 0; i < in_causal_ports.size(); i++)
+    {
+        while (in_causal_ports[i]->read(in_current_causal, false) == RTT::NewData)
+        {
+            const std::size_t elements = std::min(in_current_causal.size(), causal_storage.capacity() - causal_storage.size());
+            causal_storage.insert(causal_storage.end(), in_current_causal.begin(), in_current_causal.begin() + elements);
+        }
+    }
+}
+
+void IntrospectionReporter::writeCausalLatencies(const std::string &file_name)
+{
+    // (from, to) source ids to latencies in ns
+    std::map<std::pair<uint32_t, uint32_t>, std::vector<uint64_t> > hops;
+    std::map<std::pair<uint32_t, uint32_t>, std::vector<uint64_t> > end_to_end;
+    for (const cogimon::CallTraceCausalSample &sample : causal_storage)
+    {
+        hops[std::make_pair(sample.upstream_source, sample.reader_source)].push_back(sample.read_time > sample.write_time ? sample.read_time - sample.write_time : 0);
+        end_to_end[std::make_pair(sample.origin_source, sample.reader_source)].push_back(sample.read_time > sample.origin_time ? sample.read_time - sample.origin_time : 0);
+    }
+
+    ofstream myfile;
+    myfile.open(file_name.c_str());
+    myfile << "kind,from,to,count,min,p50,p90,p99,max,mean\n";
+    const std::pair<const char *, std::map<std::pair<uint32_t, uint32_t>, std::vector<uint64_t> > *> kinds[2] = {std::make_pair("hop", &hops), std::make_pair("end_to_end", &end_to_end)};
+    for (unsigned int k = 0; k < 2; k++)
+    {
+        for (std::map<std::pair<uint32_t, uint32_t>, std::vector<uint64_t> >::iterator path = kinds[k].second->begin(); path != kinds[k].second->end(); ++path)
+        {
+            std::vector<uint64_t> &latencies = path->second;
+            std::sort(latencies.begin(), latencies.end());
+            const std::size_t n = latencies.size();
+            double sum = 0.0;
+            for (const uint64_t latency : latencies)
+            {
+                sum += latency;
+            }
+            const std::string from = cogimon::RTTIntrospectionCausalRegistry::instance().getName(path->first.first);
+            const std::string to = cogimon::RTTIntrospectionCausalRegistry::instance().getName(path->first.second);
+            myfile << kinds[k].first << "," << from << "," << to << "," << n << "," << latencies.front() << "," << latencies[n / 2] << "," << latencies[(n * 9) / 10] << "," << latencies[(n * 99) / 100] << "," << latencies.back() << "," << sum / n << "\n";
+            if (k == 1)
+            {
+                log(Warning) << "[" << from << " -> " << to << "] end-to-end latency ns: p50 " << latencies[n / 2] << ", p99 " << latencies[(n * 99) / 100] << ", max " << latencies.back() << " (" << n << " samples)" << endlog();
+            }
+        }
+    }
+    myfile.close();
+    RTT::log(RTT::Warning) << "Finished writing to " << file_name << RTT::endlog();
+}
+
+void IntrospectionReporter::connectPerfCounters(const std::string &peerName, Service::shared_ptr intro_srv)
+{
+    RTT::base::OutputPortInterface *perf_port = dynamic_cast<RTT::base::OutputPortInterface *>(intro_srv->getPort("out_perf_counter_port"));
+    if (!perf_port)
+    {
+        return;
+    }
+    std::shared_ptr<RTT::InputPort<std::vector<cogimon::CallTracePerfSample>>> ipp(new RTT::InputPort<std::vector<cogimon::CallTracePerfSample>>("in_" + peerName + "_perf_port"));
+    this->ports()->addEventPort(*ipp.get());
+    if (!perf_port->connectTo(ipp.get(), ConnPolicy::buffer(64, ConnPolicy::LOCK_FREE)))
+    {
+        log(Warning) << "Could not connect to the perf counters of Component " << peerName << endlog();
+        this->ports()->removePort(ipp->getName());
+        return;
+    }
+    in_perf_ports.push_back(ipp);
+    perf_containers.push_back(peerName);
+    perf_storages.push_back(std::vector<cogimon::CallTracePerfSample>());
+    perf_storages.back().reserve(perf_storage_size);
+}
+
+void IntrospectionReporter::readPerfCounters()
+{
+    for (std::size_t i = 0; i < in_perf_ports.size(); i++)
+    {
+        while (in_perf_ports[i]->read(in_current_perf, false) == RTT::NewData)
+        {
+            std::vector<cogimon::CallTracePerfSample> &storage = perf_storages[i];
+            const std::size_t elements = std::min(in_current_perf.size(), storage.capacity() - storage.size());
+            storage.insert(storage.end(), in_current_perf.begin(), in_current_perf.begin() + elements);
+        }
+    }
+}
+
+void IntrospectionReporter::writePerfCounters(const std::string &file_name)
+{
+    static const char *sources[] = {"none", "perf_event", "rusage"};
+    ofstream myfile;
+    myfile.open(file_name.c_str());
+    myfile << "container_name,call_time,call_duration,cpu_start,cpu_end,sampling_factor,source,context_switches,page_faults,task_clock,cycles,instructions,llc_misses\n";
+    for (std::size_t i = 0; i < perf_storages.size(); i++)
+    {
+        for (const cogimon::CallTracePerfSample &sample : perf_storages[i])
+        {
+            myfile << perf_containers[i] << "," << sample.call_time << "," << sample.call_duration << "," << sample.cpu_start << "," << sample.cpu_end << "," << sample.sampling_factor << "," << sources[sample.source < 3 ? sample.source : 0];
+            for (unsigned int c = 0; c < cogimon::PERF_COUNTER_COUNT; c++)
+            {
+                // empty if the counter is not available
+                myfile << ",";
+                if (sample.valid & (1 << c))
                 {
-                    ctsamples_storage.push_back(in_current_var[i]);
+                    myfile << sample.values[c];
                 }
             }
+            myfile << "\n";
+        }
+    }
+    myfile.close();
+    RTT::log(RTT::Warning) << "Finished writing to " << file_name << RTT::endlog();
+}
+
+void IntrospectionReporter::writeCpuUsage(const std::string &timeline_file_name, const std::string &utilization_file_name)
+{
+    struct CpuInterval
+    {
+        uint64_t start;
+        uint64_t end;
+        std::size_t container;
+        int cpu_end;
+        uint32_t sampling_factor;
+        bool operator<(const CpuInterval &other) const
+        {
+            return start < other.start;
+        }
+    };
+    std::map<int, std::vector<CpuInterval> > cores;
+    uint64_t window_start = UINT64_MAX;
+    uint64_t window_end = 0;
+    for (std::size_t i = 0; i < perf_storages.size(); i++)
+    {
+        for (const cogimon::CallTracePerfSample &sample : perf_storages[i])
+        {
+            if (sample.cpu_start < 0)
+            {
+                continue;
+            }
+            const CpuInterval interval = {sample.call_time, sample.call_time + sample.call_duration, i, sample.cpu_end, sample.sampling_factor > 0 ? sample.sampling_factor : 1};
+            cores[sample.cpu_start].push_back(interval);
+            window_start = std::min(window_start, interval.start);
+            window_end = std::max(window_end, interval.end);
+        }
+    }
+    if (cores.empty())
+    {
+        return;
+    }
+
+    ofstream timeline;
+    if (!timeline_file_name.empty())
+    {
+        timeline.open(timeline_file_name.c_str());
+        timeline << "cpu,container_name,start,end,cpu_end\n";
+    }
+    ofstream utilization;
+    if (!utilization_file_name.empty())
+    {
+        utilization.open(utilization_file_name.c_str());
+        utilization << "cpu,busy_ns,window_ns,utilization,overlap_ns,calls,migrated_calls,container_names\n";
+    }
+    const double window = window_end > window_start ? window_end - window_start : 1;
+    for (std::map<int, std::vector<CpuInterval> >::iterator core = cores.begin(); core != cores.end(); ++core)
+    {
+        std::vector<CpuInterval> &intervals = core->second;
+        std::sort(intervals.begin(), intervals.end());
+        // busy is scaled with the sampling factor, the overlap is the traced time that is not in the union of the intervals
+        double busy = 0.0;
+        uint64_t traced = 0;
+        uint64_t merged = 0;
+        uint64_t merged_end = 0;
+        uint64_t calls = 0;
+        uint64_t migrated = 0;
+        std::set<std::string> containers;
+        for (const CpuInterval &interval : intervals)
+        {
+            const uint64_t duration = interval.end - interval.start;
+            busy += static_cast<double>(duration) * interval.sampling_factor;
+            traced += duration;
+            if (interval.end > merged_end)
+            {
+                merged += interval.end - std::max(interval.start, merged_end);
+                merged_end = interval.end;
+            }
+            calls += interval.sampling_factor;
+            if (interval.cpu_end != core->first)
+            {
+                migrated++;
+            }
+            containers.insert(perf_containers[interval.container]);
+            if (timeline.is_open())
+            {
+                timeline << core->first << "," << perf_containers[interval.container] << "," << interval.start << "," << interval.end << "," << interval.cpu_end << "\n";
+            }
+        }
+        const std::string names = boost::algorithm::join(containers, ";");
+        if (utilization.is_open())
+        {
+            utilization << core->first << "," << static_cast<uint64_t>(busy) << "," << static_cast<uint64_t>(window) << "," << busy / window << "," << traced - merged << "," << calls << "," << migrated << "," << names << "\n";
+        }
+        log(Warning) << "[cpu " << core->first << "] utilization " << busy / window * 100.0 << "% by " << names << ", overlap " << traced - merged << " ns, " << migrated << " calls ended on another cpu" << endlog();
+    }
+    if (timeline.is_open())
+    {
+        timeline.close();
+        RTT::log(RTT::Warning) << "Finished writing to " << timeline_file_name << RTT::endlog();
+    }
+    if (utilization.is_open())
+    {
+        utilization.close();
+        RTT::log(RTT::Warning) << "Finished writing to " << utilization_file_name << RTT::endlog();
+    }
+}
+
+void IntrospectionReporter::connectOverheadModel(const std::string &peerName, Service::shared_ptr intro_srv)
+{
+    RTT::base::OutputPortInterface *overhead_port = dynamic_cast<RTT::base::OutputPortInterface *>(intro_srv->getPort("out_call_trace_overhead_port"));
+    if (!overhead_port)
+    {
+        return;
+    }
+    std::shared_ptr<RTT::InputPort<Eigen::VectorXd>> ipo(new RTT::InputPort<Eigen::VectorXd>("in_" + peerName + "_overhead_port"));
+    this->ports()->addPort(*ipo.get());
+    // the model is written in configureHook, so take over the last written value
+    if (!overhead_port->connectTo(ipo.get(), ConnPolicy::data(ConnPolicy::LOCK_FREE, true, false)))
+    {
+        log(Warning) << "Could not connect to the tracing overhead model of Component " << peerName << endlog();
+        this->ports()->removePort(ipo->getName());
+        return;
+    }
+    in_overhead_ports.push_back(ipo);
+    overhead_containers.push_back(peerName);
+}
+
+void IntrospectionReporter::readBlocks()
+{
+    cogimon::CallTraceBlock *block = 0;
+    for (std::size_t i = 0; i < in_ctblock_ports.size(); i++)
+    {
+        while (in_ctblock_ports[i]->read(block, false) == RTT::NewData)
+        {
+            if (block)
+            {
+                consumeBlock(block, call_trace_losses[ctblock_containers[i]]);
+            }
+        }
+    }
+}
+
+void IntrospectionReporter::releaseBlocks()
+{
+    cogimon::CallTraceBlock *block = 0;
+    for (std::size_t i = 0; i < in_ctblock_ports.size(); i++)
+    {
+        while (in_ctblock_ports[i]->read(block, false) == RTT::NewData)
+        {
+            if (block)
+            {
+                block->release();
+            }
+        }
+        in_ctblock_ports[i]->disconnect();
+        this->ports()->removePort(in_ctblock_ports[i]->getName());
+    }
+    in_ctblock_ports.clear();
+    ctblock_containers.clear();
+}
+
+void IntrospectionReporter::updateHook()
+{
+    log(Debug) << "Logger updateHook " << endlog();
+    readFlushRequests();
+    // blocks have to be returned to the pools even if the storage is full
+    readBlocks();
+    readRecords();
+    readPerfCounters();
+    readCausalSamples();
+    readSummaries();
+    if (!this->isConfigured())
+    {
+        log(Error) << "Logger abort due to initial if (!this->isConfigured())" << endlog();
+        acknowledgeFlushRequests();
+        return;
+    }
+
+    // also read if the storage is full, so that the samples are accounted as dropped here
+    for (std::size_t i = 0; i < in_ctsamples_ports.size(); i++)
+    {
+        in_current_flow = in_ctsamples_ports[i]->read(in_current_var);
+        log(Debug) << "for each port " << in_ctsamples_ports[i]->getName() << " read: " << in_current_flow << endlog();
+        if (in_current_flow == RTT::NewData)
+        {
+            storeSamples(call_trace_losses[ctsamples_containers[i]]);
         }
     }
+    acknowledgeFlushRequests();
 }
 
 void IntrospectionReporter::stopHook()
 {
-    RTT::log(RTT::Warning) << "Logged Samples " << ctsamples_storage.size() << RTT::endlog();
+    // take over what the components flushed in their stopHook, then acknowledge before dumping
+    readFlushRequests();
+    readBlocks();
+    readRecords();
+    readPerfCounters();
+    readCausalSamples();
+    readSummaries();
+    for (std::size_t i = 0; i < in_ctsamples_ports.size(); i++)
+    {
+        if (in_ctsamples_ports[i]->read(in_current_var, false) == RTT::NewData)
+        {
+            storeSamples(call_trace_losses[ctsamples_containers[i]]);
+        }
+    }
+    acknowledgeFlushRequests();
+    // the producers wrote their final counters before the flush id
+    writeLossReport(loss_report_file);
+    RTT::log(RTT::Warning) << "Logged Samples " << ctsamples_storage.size() + ctrecords_storage.size() << RTT::endlog();
 
     ofstream myfile;
     myfile.open("rtReport.dat");
@@ -186,13 +1080,46 @@ void IntrospectionReporter::stopHook()
                    << cts;
         }
     }
+    writeRecords(myfile, first);
     myfile << "\n]}\n";
     myfile.close();
     RTT::log(RTT::Warning) << "Finished writing to rtReport.dat" << RTT::endlog();
+
+    std::map<std::string, ContainerTrace> traces;
+    if (!folded_stack_file.empty() || !corrected_durations_file.empty())
+    {
+        collectTraces(traces);
+    }
+    if (!folded_stack_file.empty())
+    {
+        writeFoldedStacks(folded_stack_file, traces);
+    }
+    if (!corrected_durations_file.empty())
+    {
+        writeCorrectedDurations(corrected_durations_file, traces);
+    }
+    if (!perf_counters_file.empty() && !in_perf_ports.empty())
+    {
+        writePerfCounters(perf_counters_file);
+    }
+    if ((!cpu_timeline_file.empty() || !cpu_utilization_file.empty()) && !in_perf_ports.empty())
+    {
+        writeCpuUsage(cpu_timeline_file, cpu_utilization_file);
+    }
+    if (!summary_file.empty() && std::any_of(summary_storages.begin(), summary_storages.end(), [](const std::vector<cogimon::CallTraceSummaryRecord> &storage) { return !storage.empty(); }))
+    {
+        writeSummaries(summary_file);
+    }
+    if (!causal_latency_file.empty() && !causal_storage.empty())
+    {
+        writeCausalLatencies(causal_latency_file);
+    }
 }
 
 void IntrospectionReporter::cleanupHook()
 {
+    releaseBlocks();
+    storage_memory.unlock();
 }
 
 } // namespace cosima
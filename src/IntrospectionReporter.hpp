@@ -44,6 +44,19 @@
 // RST-RT includes
 #include <rst-rt/monitoring/CallTraceSample.hpp>
 
+#include "rtt-introspection-block.hpp"
+#include "rtt-introspection-record.hpp"
+#include "rtt-introspection-overhead.hpp"
+#include "rtt-introspection-perf.hpp"
+#include "rtt-introspection-accounting.hpp"
+#include "rtt-introspection-memory.hpp"
+#include "rtt-introspection-causal.hpp"
+#include "rtt-introspection-summary.hpp"
+
+#include <map>
+
+#include <Eigen/Core>
+
 namespace cosima
 {
 
@@ -52,7 +65,7 @@ class IntrospectionReporter : public RTT::TaskContext {
 public:
 
     IntrospectionReporter( std::string name = "IntrospectionReporter" );
-    // virtual ~IntrospectionReporter();
+    virtual ~IntrospectionReporter();
 
     bool configureHook();
     bool startHook();
@@ -63,6 +76,14 @@ public:
 private:
 
     std::vector<std::shared_ptr<RTT::InputPort<std::vector<rstrt::monitoring::CallTraceSample> > > > in_ctsamples_ports;
+    // components that hand over their CallTraceBlocks by pointer (preferred over in_ctsamples_ports)
+    std::vector<std::shared_ptr<RTT::InputPort<cogimon::CallTraceBlock *> > > in_ctblock_ports;
+    // components that send compact records (e.g. from another process), with the matching name table ports
+    std::vector<std::shared_ptr<RTT::InputPort<std::vector<cogimon::CallTraceRecord> > > > in_ctrecord_ports;
+    std::vector<std::shared_ptr<RTT::InputPort<std::vector<std::string> > > > in_ctname_ports;
+    std::vector<std::vector<std::string> > call_name_tables;
+    // component_id of the records to the index in call_name_tables
+    std::map<uint16_t, std::size_t> call_name_table_index;
     std::vector<std::vector<rstrt::monitoring::CallTraceSample> > in_ctsamples_vars;
     // std::vector<RTT::FlowStatus> in_ctsamples_flows;
 
@@ -72,7 +93,170 @@ private:
     std::vector<rstrt::monitoring::CallTraceSample> ctsamples_storage;
     uint storage_size;
 
+    std::vector<cogimon::CallTraceRecord> in_current_records;
+    // records are only converted into CallTraceSamples when they are written to the file
+    std::vector<cogimon::CallTraceRecord> ctrecords_storage;
+
+    void readRecords();
+
+    struct TraceInterval
+    {
+        double start;
+        double end;
+        uint32_t sampling_factor;
+        uint8_t depth;
+        const std::string *call_name;
+
+        // parents first: earlier start, then longer, then less deep
+        bool operator<(const TraceInterval &other) const;
+    };
+
+    // all samples of one component
+    struct ContainerTrace
+    {
+        // CALL_START_WITH_DURATION samples (hooks and TraceScopes), sorted
+        std::vector<TraceInterval> intervals;
+        // times of all samples the component traced, sorted
+        std::vector<double> event_times;
+    };
+
+    /**
+     * Collects the samples of all storages per container.
+     */
+    void collectTraces(std::map<std::string, ContainerTrace> &traces) const;
+
+    /**
+     * Reconstructs the call tree of every cycle from the nested CALL_START_WITH_DURATION samples (hooks and TraceScopes)
+     * and writes the self time (ns, multiplied with the sampling factor) per stack in the folded format of flamegraph.pl.
+     */
+    void writeFoldedStacks(const std::string &file_name, const std::map<std::string, ContainerTrace> &traces);
+    // empty to disable
+    std::string folded_stack_file;
+
+    /**
+     * Writes raw and overhead-corrected duration of every interval, corrected with the overhead model of the component
+     * (see cogimon::RTTIntrospectionOverheadModel).
+     */
+    void writeCorrectedDurations(const std::string &file_name, const std::map<std::string, ContainerTrace> &traces);
+    // empty to disable
+    std::string corrected_durations_file;
+
+    // overhead model per component, read in stopHook
+    std::vector<std::shared_ptr<RTT::InputPort<Eigen::VectorXd> > > in_overhead_ports;
+    std::vector<std::string> overhead_containers;
+    void connectOverheadModel(const std::string &peerName, RTT::Service::shared_ptr intro_srv);
+
+    // counter deltas per component, see RTTIntrospectionBase::usePerfCounters
+    std::vector<std::shared_ptr<RTT::InputPort<std::vector<cogimon::CallTracePerfSample> > > > in_perf_ports;
+    std::vector<std::string> perf_containers;
+    std::vector<std::vector<cogimon::CallTracePerfSample> > perf_storages;
+    std::vector<cogimon::CallTracePerfSample> in_current_perf;
+    // per component
+    uint perf_storage_size;
+    // empty to disable
+    std::string perf_counters_file;
+    void connectPerfCounters(const std::string &peerName, RTT::Service::shared_ptr intro_srv);
+    void readPerfCounters();
+    void writePerfCounters(const std::string &file_name);
+    /**
+     * From the perf samples with cpus (see RTTIntrospectionBase::useCpuTrace): the updateHook() intervals per core
+     * and the utilization of each core. Overlapping intervals on one core mean that the components preempted each other.
+     */
+    void writeCpuUsage(const std::string &timeline_file_name, const std::string &utilization_file_name);
+    // empty to disable
+    std::string cpu_timeline_file;
+    std::string cpu_utilization_file;
+
+    // interval summaries per component, see RTTIntrospectionBase::call_trace_summary_mode
+    std::vector<std::shared_ptr<RTT::InputPort<std::vector<cogimon::CallTraceSummaryRecord> > > > in_summary_ports;
+    std::vector<std::shared_ptr<RTT::InputPort<std::vector<std::string> > > > in_summary_name_ports;
+    std::vector<std::string> summary_containers;
+    std::vector<std::vector<std::string> > summary_name_tables;
+    std::vector<std::vector<cogimon::CallTraceSummaryRecord> > summary_storages;
+    std::vector<cogimon::CallTraceSummaryRecord> in_current_summary;
+    // per component
+    uint summary_storage_size;
+    // empty to disable
+    std::string summary_file;
+    void connectSummary(const std::string &peerName, RTT::Service::shared_ptr intro_srv);
+    void readSummaries();
+    void writeSummaries(const std::string &file_name);
+
+    // hops of the causal chains of all components, see RTTIntrospectionBase::useCausalTrace
+    std::vector<std::shared_ptr<RTT::InputPort<std::vector<cogimon::CallTraceCausalSample> > > > in_causal_ports;
+    std::vector<cogimon::CallTraceCausalSample> causal_storage;
+    std::vector<cogimon::CallTraceCausalSample> in_current_causal;
+    uint causal_storage_size;
+    // empty to disable
+    std::string causal_latency_file;
+    void connectCausalTrace(const std::string &peerName, RTT::Service::shared_ptr intro_srv);
+    void readCausalSamples();
+    /**
+     * Writes the latency distributions per hop (upstream output port to input port) and end to end
+     * (output port where the chain started to input port). The ports are named by cogimon::RTTIntrospectionCausalRegistry.
+     */
+    void writeCausalLatencies(const std::string &file_name);
+
+    /**
+     * Connects the ports besides the samples: flush handshake, overhead model and perf counters.
+     */
+    void connectAuxiliaryPorts(const std::string &peerName, RTT::Service::shared_ptr intro_srv);
+
+    // flush handshake with the components, see RTTIntrospectionBase::flushCallTraces()
+    std::vector<std::shared_ptr<RTT::InputPort<uint_least64_t> > > in_flush_ports;
+    std::vector<std::shared_ptr<RTT::OutputPort<uint_least64_t> > > out_flush_ack_ports;
+    // last flush id per component that still has to be acknowledged, 0 if none
+    std::vector<uint_least64_t> flush_requests;
+
+    void connectFlushHandshake(const std::string &peerName, RTT::Service::shared_ptr intro_srv);
+    /**
+     * Has to be called before the samples are read: everything written before the flush id is then readable.
+     */
+    void readFlushRequests();
+    void acknowledgeFlushRequests();
+    void writeRecords(std::ostream &out, bool &first);
+
+    /**
+     * Appends the events of the block to the ctsamples_storage and returns the block to its pool.
+     */
+    void consumeBlock(cogimon::CallTraceBlock *block, cogimon::CallTraceLoss &loss);
+    /**
+     * Reads and releases all pending blocks, so that the producers can reuse them.
+     */
+    void readBlocks();
+    /**
+     * Releases all pending blocks without storing them and disconnects the block ports,
+     * so that no block pointer is left behind in a connection that nobody reads anymore.
+     */
+    void releaseBlocks();
+
     RTT::ConnPolicy report_policy;
+
+    // peer names in the order of in_ctsamples_ports, in_ctblock_ports and in_ctrecord_ports
+    std::vector<std::string> ctsamples_containers;
+    std::vector<std::string> ctblock_containers;
+    std::vector<std::string> ctrecord_containers;
+    // per peer, from the batch sequence numbers
+    std::map<std::string, cogimon::CallTraceLoss> call_trace_losses;
+    // counters of the producers, see cogimon::CallTraceAccountingIndex
+    std::vector<std::shared_ptr<RTT::InputPort<Eigen::VectorXd> > > in_accounting_ports;
+    std::vector<std::string> accounting_containers;
+    // empty to disable
+    std::string loss_report_file;
+
+    // prefault and mlock the storages in configureHook
+    bool lock_memory;
+    cogimon::RTTIntrospectionMemoryLock storage_memory;
+    void lockStorageMemory();
+    void connectAccounting(const std::string &peerName, RTT::Service::shared_ptr intro_srv);
+    /**
+     * Appends in_current_var to the ctsamples_storage as far as it fits, without the sequence marker.
+     */
+    void storeSamples(cogimon::CallTraceLoss &loss);
+    /**
+     * Logs and writes the loss per component: dropped by the producer, overwritten on the way and dropped here.
+     */
+    void writeLossReport(const std::string &file_name);
 };
 
 }
@@ -0,0 +1,102 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_ACCOUNTING_HPP
+#define RTT_INTROSPECTION_ACCOUNTING_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+#include <Eigen/Core>
+
+namespace cogimon
+{
+
+/**
+ * Layout of out_call_trace_accounting_port. All counts are call trace events, markers are not counted.
+ *
+ * produced = events the component traced, dropped = of those the ones that did not fit into the block pool,
+ * sent = events written to one of the output ports, batches = sequence number of the last batch sent.
+ * Each batch carries its sequence number (CallTraceBlock::sequence, a record with FLAG_BATCH_SEQUENCE
+ * or a BATCH_SEQUENCE_NAME sample at the front), so that the consumer can detect overwritten batches.
+ */
+enum CallTraceAccountingIndex
+{
+	ACCOUNTING_COMPONENT_ID = 0,
+	ACCOUNTING_PRODUCED = 1,
+	ACCOUNTING_DROPPED = 2,
+	ACCOUNTING_SENT = 3,
+	ACCOUNTING_BATCHES = 4,
+	ACCOUNTING_SIZE = 5
+};
+
+// call_name of the sample at the front of each out_call_trace_sample_vec_port batch, call_duration holds the sequence number
+static const char *const BATCH_SEQUENCE_NAME = "batchSequence()";
+
+/**
+ * Real-time safe increment of a counter that only one thread writes at a time, without a locked instruction.
+ */
+inline void addCallTraceCount(std::atomic<uint_least64_t> &counter, const uint_least64_t count)
+{
+	counter.store(counter.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+}
+
+/**
+ * Loss of one component as seen by the consumer.
+ */
+struct CallTraceLoss
+{
+	CallTraceLoss() : received(0), stored(0), batches(0), missing_batches(0), last_sequence(0)
+	{
+	}
+
+	/**
+	 * A batch with events of which stored fitted into the storage of the consumer.
+	 */
+	void addBatch(const uint_least64_t sequence, const uint_least64_t events, const uint_least64_t stored)
+	{
+		// sequences restart when the component is reconfigured
+		if (sequence > last_sequence + 1 && last_sequence > 0)
+		{
+			missing_batches += sequence - last_sequence - 1;
+		}
+		last_sequence = sequence;
+		batches++;
+		received += events;
+		this->stored += stored;
+	}
+
+	uint_least64_t received;
+	uint_least64_t stored;
+	uint_least64_t batches;
+	uint_least64_t missing_batches;
+	uint_least64_t last_sequence;
+};
+
+} // namespace cogimon
+#endif
@@ -27,10 +27,16 @@
  * ============================================================ */
 #include "rtt-introspection-base.hpp"
 #include <rtt/Operation.hpp>
+#include <rtt/internal/ConnectionManager.hpp>
+#include <rtt/internal/ConnID.hpp>
 #include <string>
 #include <fstream>
 #include <streambuf>
 #include <limits>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <sched.h>
 
 #include <iostream>
 
@@ -39,57 +45,366 @@ using namespace RTT;
 using namespace RTT::os;
 using namespace Eigen;
 
+// process-wide counter for the component ids of the call trace name registry
+static std::atomic<unsigned int> next_component_id(0);
+
+RTTIntrospectionCausalRegistry &RTTIntrospectionCausalRegistry::instance()
+{
+	static RTTIntrospectionCausalRegistry registry;
+	return registry;
+}
+
 RTTIntrospectionBase::RTTIntrospectionBase(const std::string &name) : TaskContext(name),
 																	  useCallTraceIntrospection(false),
 																	  usePortTraceIntrospection(false),
-																	  call_trace_storage_size(200),
+																	  useTSCClock(false),
+																	  usePerfCounters(false),
+																	  useSharedMemoryTrace(false),
+																	  useMemoryLock(false),
+																	  useTriggerIntrospection(false),
+																	  useCausalTrace(false),
+																	  useCpuTrace(false),
+																	  call_trace_block_port_unbuffered(false),
+																	  call_trace_flush_id(0),
+																	  call_trace_flush_timeout(1.0),
+																	  call_trace_flushing(false),
+																	  call_trace_flush_deadline(0),
+																	  call_names_open(false),
 																	  cts_send_latest_after(UINT_LEAST64_MAX),
 																	  cts_last_send(0),
-																	  cts_send_pro_hook(true),
-																	  wmect(0),
 																	  send_at_least_once_per_Xms(0),
 																	  last_send(0),
-																	  auto_write_execution_information(false)
+																	  call_trace_block(0),
+																	  call_trace_block_start(0),
+																	  call_trace_block_max_age(0),
+																	  call_trace_block_limit(1),
+																	  call_trace_block_capacity(1),
+																	  call_trace_cycles(0),
+																	  call_trace_block_start_cycle(0),
+																	  call_trace_summary_mode(false),
+																	  call_trace_summary_period(1.0),
+																	  call_trace_summary_active(false),
+																	  call_trace_ring_size(4096),
+																	  call_trace_ring_overflows(0),
+																	  call_trace_events_stored(0),
+																	  call_trace_cycle_sampled(true),
+																	  call_trace_cycle_factor(1),
+																	  trace_scope_depth(0),
+																	  sampling_factor_name_id(0),
+																	  call_trace_storage_events(0),
+																	  batch_sampling_factor(0),
+																	  call_trace_shm_size(65536),
+																	  call_trace_batch_sequence(0),
+																	  call_trace_events_sent(0),
+																	  call_trace_drain_running(false),
+																	  call_trace_drain_enabled(false),
+																	  call_trace_drain_period(0.01),
+																	  call_trace_storage_size(200),
+																	  cts_send_pro_hook(true),
+																	  wmect(0),
+																	  auto_write_execution_information(false),
+																	  overhead_update_counter(0),
+																	  latency_statistics_period(1.0),
+																	  last_latency_statistics_send(0),
+																	  perf_counters_opened(false),
+																	  activity_period(0),
+																	  last_update_start(0),
+																	  deadline_misses(0),
+																	  last_cpu(-1),
+																	  cpu_affinity(0),
+																	  cpu_migrations(0),
+																	  cpu_off_affinity(0),
+																	  call_trace_setting(new RTTIntrospectionSettingDataSource<bool>(useCallTraceIntrospection, [this](const bool enable) { requestCallTrace(enable); })),
+																	  port_trace_setting(new RTTIntrospectionSettingDataSource<bool>(usePortTraceIntrospection, [this](const bool enable) { requestPortTrace(enable); })),
+																	  storage_size_setting(new RTTIntrospectionSettingDataSource<std::size_t>(call_trace_storage_size, [this](const std::size_t size) { setCallTraceStorageSize(static_cast<int>(size)); })),
+																	  call_trace_property("useCallTraceIntrospection", "Enable/Disable the introspection output.", call_trace_setting),
+																	  port_trace_property("usePortTraceIntrospection", "Enable/Disable the port introspection output.", port_trace_setting),
+																	  storage_size_property("call_trace_storage_size", "Storage capacity.", storage_size_setting)
 {
-	this->provides("introspection")->addProperty("useCallTraceIntrospection", useCallTraceIntrospection).doc("Enable/Disable the introspection output.");
-	this->provides("introspection")->addProperty("usePortTraceIntrospection", usePortTraceIntrospection).doc("Enable/Disable the port introspection output.");
+	this->provides("introspection")->addProperty(call_trace_property);
+	this->provides("introspection")->addProperty(port_trace_property);
+	this->provides("introspection")->addProperty("useTSCClock", useTSCClock).doc("Use the invariant TSC instead of the TimeService for the call trace timestamps (calibrated in configureHook).");
 	// this->provides("introspection")->addProperty("cts_send_latest_after", cts_send_latest_after).doc("Amount of time that can maximally pass before sending the samples.");
-	this->provides("introspection")->addProperty("call_trace_storage_size", call_trace_storage_size).doc("Storage capacity.");
+	this->provides("introspection")->addProperty("usePerfCounters", usePerfCounters).doc("Measure context switches, page faults, task clock, cycles, instructions and LLC misses of each traced updateHookInternal() (perf_event_open, falling back to getrusage). The counters are opened in the first sampled cycle, which costs up to 12 perf_event_open calls once.");
+	this->provides("introspection")->addProperty("useSharedMemoryTrace", useSharedMemoryTrace).doc("Write the call traces into the shared memory ring /dev/shm/rtt-introspection.<pid>.<name> for rtt-introspection-collector instead of the output ports (applied in configureHook).");
+	this->provides("introspection")->addProperty("useMemoryLock", useMemoryLock).doc("Prefault and mlock all introspection buffers in configureHook, so that they never page-fault at runtime (needs a sufficient RLIMIT_MEMLOCK).");
+	this->provides("introspection")->addProperty("useTriggerIntrospection", useTriggerIntrospection).doc("Trace which event port woke updateHook() up and the latency from the write to the start of updateHook() as trigger(<port>) events, only for non-periodic activities (applied in configureHook).");
+	this->provides("introspection")->addProperty("useCausalTrace", useCausalTrace).doc("Pass a sequence id and origin time from the samples read to the samples written and send a hop sample for each read of new data on out_causal_trace_port, for the pipeline latencies in the reporter. Only data connections between components of this process are followed (applied in configureHook).");
+	this->provides("introspection")->addProperty("useCpuTrace", useCpuTrace).doc("Record the cpu (sched_getcpu) before and after each updateHookInternal() in the samples of out_perf_counter_port and count the thread migrations.");
+	this->provides("introspection")->addOperation("getLockedIntrospectionMemory", &RTTIntrospectionBase::getLockedIntrospectionMemory, this).doc("Returns the bytes of introspection memory that are locked.");
+	this->provides("introspection")->addProperty("call_trace_shm_size", call_trace_shm_size).doc("Number of call trace records in the shared memory ring, rounded up to a power of two.");
+	this->provides("introspection")->addProperty(storage_size_property);
+	this->provides("introspection")->addProperty("call_trace_ring_size", call_trace_ring_size).doc("Number of call trace samples that can be buffered between the real-time thread and the consumer, allocated as blocks of call_trace_storage_size (applied in configureHook).");
+	this->provides("introspection")->addProperty("call_trace_sampling_mode", call_trace_sampler.mode).doc("0: trace every cycle, 1: trace 1 of call_trace_sampling_interval cycles, 2: trace cycles with call_trace_sampling_probability, 3: adapt the interval to call_trace_event_budget.");
+	this->provides("introspection")->addProperty("call_trace_sampling_interval", call_trace_sampler.interval).doc("N for sampling mode 1.");
+	this->provides("introspection")->addProperty("call_trace_sampling_probability", call_trace_sampler.probability).doc("Probability (0-1] for sampling mode 2, rounded to 1/N at configure.");
+	this->provides("introspection")->addProperty("call_trace_event_budget", call_trace_sampler.event_budget).doc("Events per second for sampling mode 3.");
+	this->provides("introspection")->addProperty("call_trace_selection", call_trace_selection).doc("Comma separated name patterns (e.g. \"-*,robot_*,updateHook()\"), applied in order in configureHook, a leading '-' disables the tracing of the matching ports, hooks and TraceScopes. Empty traces everything.");
+	this->provides("introspection")->addOperation("setTraceEnabled", &RTTIntrospectionBase::setTraceEnabled, this).doc("Enables or disables the tracing of the ports, hooks and TraceScopes matching the pattern (e.g. robot_*), picked up in the next updateHook. Returns the number of matches.");
+	this->provides("introspection")->addOperation("getTraceEnabledNames", &RTTIntrospectionBase::getTraceEnabledNames, this).doc("Returns the names of the ports, hooks and TraceScopes that are traced.");
+	this->provides("introspection")->addProperty("call_trace_auto_batch", call_trace_batch_tuner.enabled).doc("Tune the batch size (up to call_trace_storage_size) and the send interval at runtime instead of using call_trace_storage_size and sendAtLeastOncePerXms (applied in configureHook).");
+	this->provides("introspection")->addProperty("call_trace_flush_budget", call_trace_batch_tuner.flush_budget).doc("Auto batch: ns per updateHook that may be spent on publishing blocks, 0 for no limit.");
+	this->provides("introspection")->addProperty("call_trace_max_latency", call_trace_batch_tuner.max_latency).doc("Auto batch: ms until a traced event should have been released by the consumer.");
+	this->provides("introspection")->addProperty("call_trace_summary_mode", call_trace_summary_mode).doc("Send per port and hook counters (reads with new, old and no data, writes) and duration statistics once per call_trace_summary_period on out_call_trace_summary_port instead of the raw call trace events (applied in configureHook).");
+	this->provides("introspection")->addProperty("call_trace_summary_period", call_trace_summary_period).doc("Summary mode: interval (s) of the summary records.");
+	this->provides("introspection")->addProperty("call_trace_drain_period", call_trace_drain_period).doc("Period (s) in which the non real-time drain thread forwards the collected samples.");
+	this->provides("introspection")->addProperty("call_trace_flush_timeout", call_trace_flush_timeout).doc("Time (s) stopHook and cleanupHook wait for the collector to acknowledge the remaining call trace samples, and again for the collector of the shared memory ring, so stop() can block for twice this time.");
 	this->provides("introspection")->addOperation("setCallTraceStorageSize", &RTTIntrospectionBase::setCallTraceStorageSize, this).doc("Set the size of the introspection output storage.");
 	this->provides("introspection")->addOperation("enableAllIntrospection", &RTTIntrospectionBase::enableAllIntrospection, this).doc("Enables or Disables all introspection capabilities.");
 
-	this->provides("introspection")->addOperation("writeDebugInformation", &RTTIntrospectionBase::writeDebugInformation, this).doc("Writes Debug Information to File (Not Real-Time Safe).");
+	this->provides("introspection")->addOperation("writeDebugInformation", &RTTIntrospectionBase::writeDebugInformation, this).doc("Writes the execution times in the background to <name>-executionTime_<ns>.bin (convert with rtt-introspection-dump2csv) and logs the latency statistics (Not Real-Time Safe).");
 
 	this->provides("introspection")->addOperation("sendAtLeastOncePerXms", &RTTIntrospectionBase::sendAtLeastOncePerXms, this).doc("Set how often collected samples should be forwarded to the collector, regardless of the amount of collected samples. Parameter experts milliseconds. 0 means that this variable will not be considered at all.");
 
+	this->provides("introspection")->addProperty("latency_statistics_period", latency_statistics_period).doc("Period (s) in which the latency percentiles are written to out_latency_statistics_port. 0 disables the port, changes take effect with the next start.");
+	this->provides("introspection")->addOperation("getUpdateHookLatencyPercentile", &RTTIntrospectionBase::getUpdateHookLatencyPercentile, this).doc("Returns the given percentile (0-100) of the updateHookInternal() durations in ns.");
+	this->provides("introspection")->addOperation("getIntrospectionOverheadPercentile", &RTTIntrospectionBase::getIntrospectionOverheadPercentile, this).doc("Returns the given percentile (0-100) of the introspection overhead per updateHook() in ns.");
+	this->provides("introspection")->addOperation("getPeriodJitterPercentile", &RTTIntrospectionBase::getPeriodJitterPercentile, this).doc("Returns the given percentile (0-100) of the absolute deviation of the start-to-start period of updateHook() from the activity period in ns.");
+	this->provides("introspection")->addOperation("getTriggerLatencyPercentile", &RTTIntrospectionBase::getTriggerLatencyPercentile, this).doc("Returns the given percentile (0-100) of the latency from the port write that triggered updateHook() to its start in ns.");
+	this->provides("introspection")->addOperation("getCpuMigrations", &RTTIntrospectionBase::getCpuMigrations, this).doc("Returns how often the thread was on another cpu at the end of updateHook() or at the start of the next one, see useCpuTrace.");
+	this->provides("introspection")->addOperation("getCpuOffAffinity", &RTTIntrospectionBase::getCpuOffAffinity, this).doc("Returns how often updateHook() started on a cpu outside of the cpu affinity of the activity, see useCpuTrace.");
+	this->provides("introspection")->addOperation("getDeadlineMisses", &RTTIntrospectionBase::getDeadlineMisses, this).doc("Returns how often updateHook() took longer than the activity period.");
+	this->provides("introspection")->addOperation("printLatencyStatistics", &RTTIntrospectionBase::printLatencyStatistics, this).doc("Logs p50/p99/p99.9/max of the updateHookInternal() durations and the introspection overhead.");
+
 	this->provides("introspection")->addOperation("enableAutoWriteExecutionInformation", &RTTIntrospectionBase::enableAutoWriteExecutionInformation, this).doc("Enables or Disables automatic writing of execution time information when a component is stopped.");
 
+	component_id = next_component_id++;
+	call_names.reset(this->getName());
+	this->provides("introspection")->addAttribute("component_id", component_id);
+	std::string unknown_call_name_prototype;
+	unknown_call_name_prototype.reserve(UNKNOWN_CALL_NAME_LENGTH);
+	unknown_call_name_ring.resize(16, unknown_call_name_prototype);
+
 	time_service = RTT::os::TimeService::Instance();
 	wmectI = 0;
 
 	executionTimes.reserve(50000);
 	executionTimes.clear();
+
+	for (unsigned int i = 0; i < MAX_TRACE_SCOPE_DEPTH; i++)
+	{
+		trace_scope_stack[i].call_type = rstrt::monitoring::CallTraceSample::CALL_START_WITH_DURATION;
+		trace_scope_stack[i].depth = i + 1;
+	}
+
+	latency_statistics = Eigen::VectorXd::Zero(LATENCY_STATISTICS_SIZE);
+	overhead_model_ns = Eigen::VectorXd::Zero(RTTIntrospectionOverheadModel::MODEL_SIZE);
+	call_trace_accounting = Eigen::VectorXd::Zero(ACCOUNTING_SIZE);
+}
+
+RTTIntrospectionBase::~RTTIntrospectionBase()
+{
+	stopCallTraceDrain();
+	releaseQueuedCallTraceBlocks();
+	reclaimCallTraceBlockPool();
+	unregisterCausalPorts();
+	call_trace_shm.close();
 }
 
 void RTTIntrospectionBase::enableAllIntrospection(const bool enable)
 {
-	useCallTraceIntrospection = enable;
-	usePortTraceIntrospection = enable;
-	enableAutoWriteExecutionInformation(enable);
+	settings_handover.update([enable](RTTIntrospectionSettings &settings) {
+		settings.changed |= RTTIntrospectionSettings::CALL_TRACE | RTTIntrospectionSettings::PORT_TRACE | RTTIntrospectionSettings::AUTO_WRITE;
+		settings.call_trace = enable;
+		settings.port_trace = enable;
+		settings.auto_write = enable;
+	});
+	call_trace_setting->mirror(enable);
+	port_trace_setting->mirror(enable);
+	updateCallTraceDrain(enable);
+}
+
+void RTTIntrospectionBase::requestCallTrace(const bool enable)
+{
+	settings_handover.update([enable](RTTIntrospectionSettings &settings) {
+		settings.changed |= RTTIntrospectionSettings::CALL_TRACE;
+		settings.call_trace = enable;
+	});
+	updateCallTraceDrain(enable);
+}
+
+void RTTIntrospectionBase::requestPortTrace(const bool enable)
+{
+	settings_handover.update([enable](RTTIntrospectionSettings &settings) {
+		settings.changed |= RTTIntrospectionSettings::PORT_TRACE;
+		settings.port_trace = enable;
+	});
 }
 
 void RTTIntrospectionBase::sendAtLeastOncePerXms(const uint_least64_t Xms)
 {
 	send_at_least_once_per_Xms = Xms;
+	const uint_least64_t max_age = trace_clock.durationFromNSecs(Xms * 1000000);
+	settings_handover.update([max_age](RTTIntrospectionSettings &settings) {
+		settings.changed |= RTTIntrospectionSettings::MAX_AGE;
+		settings.max_age = max_age;
+	});
+}
+
+void RTTIntrospectionBase::applyIntrospectionSettings(const RTTIntrospectionSettings &settings)
+{
+	if (settings.changed & RTTIntrospectionSettings::CALL_TRACE)
+	{
+		useCallTraceIntrospection = settings.call_trace;
+	}
+	if (settings.changed & RTTIntrospectionSettings::PORT_TRACE)
+	{
+		usePortTraceIntrospection = settings.port_trace;
+	}
+	if (settings.changed & RTTIntrospectionSettings::AUTO_WRITE)
+	{
+		auto_write_execution_information = settings.auto_write;
+	}
+	// the tuner owns the batch size and age
+	if ((settings.changed & RTTIntrospectionSettings::MAX_AGE) && !call_trace_batch_tuner.enabled)
+	{
+		call_trace_block_max_age = settings.max_age;
+	}
+	if ((settings.changed & RTTIntrospectionSettings::BLOCK_LIMIT) && !call_trace_batch_tuner.enabled)
+	{
+		// a fuller block is published with the next event
+		call_trace_block_limit = std::max<std::size_t>(std::min(settings.block_limit, call_trace_block_capacity), 1);
+		overhead_model.setEventsPerFlush(call_trace_block_limit);
+	}
+}
+
+void RTTIntrospectionBase::adoptDrainStorage()
+{
+	RTTIntrospectionDrainStorage *storage = storage_handover.take();
+	if (!storage)
+	{
+		return;
+	}
+	if (!call_trace_storage.empty())
+	{
+		publishCallTraceSamples();
+	}
+	if (!call_trace_records.empty())
+	{
+		publishCallTraceRecords();
+	}
+	if (!perf_storage.empty())
+	{
+		publishPerfSamples();
+	}
+	if (!causal_storage.empty())
+	{
+		publishCausalSamples();
+	}
+	// the replaced storages are freed by the next setCallTraceStorageSize()
+	call_trace_storage.swap(storage->samples);
+	call_trace_records.swap(storage->records);
+	perf_storage.swap(storage->perf);
+	causal_storage.swap(storage->causal);
+	std::swap(call_trace_storage_size, storage->size);
+	storage_handover.retire(storage);
+}
+
+unsigned int RTTIntrospectionBase::setTraceEnabled(const std::string &pattern, const bool enable)
+{
+	const std::size_t matches = trace_mask.select(call_names.getNames(), pattern, enable);
+	if (matches == 0)
+	{
+		RTT::log(RTT::Warning) << "[" << this->getName() << "] No port, hook or scope matches " << pattern << "." << RTT::endlog();
+	}
+	return matches;
+}
+
+std::vector<std::string> RTTIntrospectionBase::getTraceEnabledNames()
+{
+	return trace_mask.getEnabled(call_names.getNames());
+}
+
+void RTTIntrospectionBase::applyTraceSelection(const std::string &selection)
+{
+	std::stringstream patterns(selection);
+	std::string pattern;
+	while (std::getline(patterns, pattern, ','))
+	{
+		pattern.erase(0, pattern.find_first_not_of(" \t"));
+		pattern.erase(pattern.find_last_not_of(" \t") + 1);
+		if (pattern.empty())
+		{
+			continue;
+		}
+		const bool enable = pattern[0] != '-';
+		setTraceEnabled(enable ? pattern : pattern.substr(1), enable);
+	}
+}
+
+void RTTIntrospectionBase::lockIntrospectionMemory()
+{
+	introspection_memory.unlock();
+	// members like the histograms and the scope stack, already written by the constructor
+	introspection_memory.lock(this, sizeof(*this), false);
+	introspection_memory.lock(executionTimes);
+	for (const CallTraceBlock &block : call_trace_block_pool.getBlocks())
+	{
+		introspection_memory.lock(block.events);
+	}
+	introspection_memory.lock(call_trace_block_pool.getBlocks());
+	introspection_memory.lock(call_trace_blocks_filled.getSlots());
+	introspection_memory.lock(perf_ring.getSlots());
+	// drain thread
+	introspection_memory.lock(call_trace_storage);
+	introspection_memory.lock(call_trace_records);
+	introspection_memory.lock(perf_storage);
+	introspection_memory.lock(causal_ring.getSlots());
+	introspection_memory.lock(causal_storage);
+	introspection_memory.lock(call_trace_summary.getEntries(0));
+	introspection_memory.lock(call_trace_summary.getEntries(1));
+	introspection_memory.lock(call_trace_summary_records);
+	introspection_memory.lock(call_trace_shm_buffer);
+	if (call_trace_shm.isOpen())
+	{
+		introspection_memory.lock(&call_trace_shm.getHeader(), call_trace_shm.getMappedSize());
+	}
+
+	if (introspection_memory.getError() != 0)
+	{
+		RTT::log(RTT::Warning) << "[" << this->getName() << "] Could only lock " << introspection_memory.getLocked() / 1024 << " of " << introspection_memory.getPrefaulted() / 1024 << " KiB of introspection memory (" << std::strerror(introspection_memory.getError()) << "), the rest is prefaulted. Consider raising RLIMIT_MEMLOCK." << RTT::endlog();
+	}
+	else
+	{
+		RTT::log(RTT::Info) << "[" << this->getName() << "] Locked " << introspection_memory.getLocked() / 1024 << " KiB of introspection memory." << RTT::endlog();
+	}
+}
+
+uint_least64_t RTTIntrospectionBase::getLockedIntrospectionMemory()
+{
+	return introspection_memory.getLocked();
 }
 
 void RTTIntrospectionBase::enableAutoWriteExecutionInformation(const bool enable)
 {
-	auto_write_execution_information = enable;
+	settings_handover.update([enable](RTTIntrospectionSettings &settings) {
+		settings.changed |= RTTIntrospectionSettings::AUTO_WRITE;
+		settings.auto_write = enable;
+	});
 }
 
 bool RTTIntrospectionBase::configureHook()
 {
+	// the trace clock is (re)calibrated below, so start with the time service
+	const uint_least64_t configure_start = time_service->getNSecs();
+	stopCallTraceDrain();
+	// blocks that the consumer did not release yet still point into the old pool
+	releaseQueuedCallTraceBlocks();
+	reclaimCallTraceBlockPool();
+	// everything is traced until the names are known
+	trace_mask.resize(0);
+	// the buffers are reallocated below
+	introspection_memory.unlock();
+	trigger_table.arm(false);
+	// the drain thread is stopped, so this thread adopts what the operations requested
+	adoptIntrospectionSettings();
+	RTTIntrospectionDrainStorage *requested_storage = storage_handover.take();
+	if (requested_storage)
+	{
+		call_trace_storage_size = requested_storage->size;
+		storage_handover.retire(requested_storage);
+	}
+
 	if (this->provides("introspection")->getPort("out_call_trace_sample_port"))
 	{
 		this->provides("introspection")->removePort("out_call_trace_sample_port");
@@ -98,22 +413,73 @@ bool RTTIntrospectionBase::configureHook()
 	{
 		this->provides("introspection")->removePort("out_call_trace_sample_vec_port");
 	}
+	if (this->provides("introspection")->getPort("out_call_trace_record_port"))
+	{
+		this->provides("introspection")->removePort("out_call_trace_record_port");
+	}
+	if (this->provides("introspection")->getPort("out_call_trace_block_port"))
+	{
+		this->provides("introspection")->removePort("out_call_trace_block_port");
+	}
+	if (this->provides("introspection")->getPort("out_call_trace_flush_port"))
+	{
+		this->provides("introspection")->removePort("out_call_trace_flush_port");
+	}
+	if (this->provides("introspection")->getPort("in_call_trace_flush_ack_port"))
+	{
+		this->provides("introspection")->removePort("in_call_trace_flush_ack_port");
+	}
+	if (this->provides("introspection")->getPort("out_call_name_table_port"))
+	{
+		this->provides("introspection")->removePort("out_call_name_table_port");
+	}
+	if (this->provides("introspection")->getPort("out_latency_statistics_port"))
+	{
+		this->provides("introspection")->removePort("out_latency_statistics_port");
+	}
+	if (this->provides("introspection")->getPort("out_perf_counter_port"))
+	{
+		this->provides("introspection")->removePort("out_perf_counter_port");
+	}
+	if (this->provides("introspection")->getPort("out_call_trace_overhead_port"))
+	{
+		this->provides("introspection")->removePort("out_call_trace_overhead_port");
+	}
+	if (this->provides("introspection")->getPort("out_call_trace_accounting_port"))
+	{
+		this->provides("introspection")->removePort("out_call_trace_accounting_port");
+	}
+	if (this->provides("introspection")->getPort("out_causal_trace_port"))
+	{
+		this->provides("introspection")->removePort("out_causal_trace_port");
+	}
+	if (this->provides("introspection")->getPort("out_call_trace_summary_port"))
+	{
+		this->provides("introspection")->removePort("out_call_trace_summary_port");
+	}
+	call_trace_summary_active = false;
 	//prepare introspection output variables
-	cts_start = rstrt::monitoring::CallTraceSample("startHook()", this->getName(), 0.0, rstrt::monitoring::CallTraceSample::CALL_UNIVERSAL);
-	cts_configure = rstrt::monitoring::CallTraceSample("configureHook()", this->getName(), 0.0, rstrt::monitoring::CallTraceSample::CALL_UNIVERSAL);
-	cts_update = rstrt::monitoring::CallTraceSample("updateHook()", this->getName(), 0.0, rstrt::monitoring::CallTraceSample::CALL_UNIVERSAL);
-	cts_stop = rstrt::monitoring::CallTraceSample("stopHook()", this->getName(), 0.0, rstrt::monitoring::CallTraceSample::CALL_UNIVERSAL);
-	cts_cleanup = rstrt::monitoring::CallTraceSample("cleanupHook()", this->getName(), 0.0, rstrt::monitoring::CallTraceSample::CALL_UNIVERSAL);
-
-	cts_port = rstrt::monitoring::CallTraceSample("port_access######################################",
-												  this->getName(), 0.0, rstrt::monitoring::CallTraceSample::CALL_UNIVERSAL);
+	port_name_ids.clear();
+
+	cte_start.call_name_id = call_names.registerName("startHook()");
+	cte_configure.call_name_id = call_names.registerName("configureHook()");
+	cte_update.call_name_id = call_names.registerName("updateHook()");
+	cte_stop.call_name_id = call_names.registerName("stopHook()");
+	cte_cleanup.call_name_id = call_names.registerName("cleanupHook()");
+	cte_deadline_miss.call_name_id = call_names.registerName(DEADLINE_MISS_NAME);
+	cte_deadline_miss.call_type = rstrt::monitoring::CallTraceSample::CALL_START_WITH_DURATION;
+	sampling_factor_name_id = call_names.registerName(SAMPLING_FACTOR_NAME);
+
+	// names are only resolved by the drain thread
+	cts_prototype = rstrt::monitoring::CallTraceSample("", this->getName(), 0.0, rstrt::monitoring::CallTraceSample::CALL_UNIVERSAL);
+
 	//prepare introspection output ports
 	out_call_trace_sample_port.setName("out_call_trace_sample_port");
 	out_call_trace_sample_port.doc("Output port for call trace samples");
-	out_call_trace_sample_port.setDataSample(cts_update);
+	out_call_trace_sample_port.setDataSample(cts_prototype);
 	this->provides("introspection")->addPort(out_call_trace_sample_port);
 
-	call_trace_storage.resize(call_trace_storage_size);
+	call_trace_storage.resize(call_trace_storage_size, cts_prototype);
 	call_trace_storage.reserve(call_trace_storage_size);
 
 	out_call_trace_sample_vec_port.setName("out_call_trace_sample_vec_port");
@@ -123,208 +489,1336 @@ bool RTTIntrospectionBase::configureHook()
 	// empty but capacity is unchanged!
 	call_trace_storage.clear();
 
-	cts_last_send = 0;
-
-	return configureHookInternal();
-}
+	call_trace_records.resize(call_trace_storage_size);
+	out_call_trace_record_port.setName("out_call_trace_record_port");
+	out_call_trace_record_port.doc("Output port for compact call trace records, the names are published on out_call_name_table_port");
+	out_call_trace_record_port.setDataSample(call_trace_records);
+	this->provides("introspection")->addPort(out_call_trace_record_port);
+	call_trace_records.clear();
 
-void RTTIntrospectionBase::updateHook()
-{
-	uint_least64_t overhead_start = time_service->getNSecs();
-	if (useCallTraceIntrospection)
+	const std::size_t block_size = call_trace_storage_size > 0 ? call_trace_storage_size : 1;
+	if (!call_trace_block_pool.resize((call_trace_ring_size + block_size - 1) / block_size, block_size, CallTraceBlock()))
 	{
-		cts_update.call_time = time_service->getNSecs();
-		cts_update.call_type = rstrt::monitoring::CallTraceSample::CALL_START_WITH_DURATION;
+		RTT::log(RTT::Error) << "[" << this->getName() << "] " << call_trace_block_pool.inUse() << " call trace blocks are still held by a consumer, can not reallocate the pool." << RTT::endlog();
+		return false;
+	}
+	call_trace_blocks_filled.resize(call_trace_block_pool.size(), static_cast<CallTraceBlock *>(0));
+	call_trace_events_stored = 0;
 
-		// launch internal updateHook
-		updateHookInternal();
+	out_call_trace_block_port.setName("out_call_trace_block_port");
+	out_call_trace_block_port.doc("Output port for blocks of call trace events (by pointer), the receiver has to release() them after reading");
+	out_call_trace_block_port.setDataSample(0);
+	this->provides("introspection")->addPort(out_call_trace_block_port);
+	batch_sampling_factor = 0;
 
-		cts_update.call_duration = time_service->getNSecs();
-		uint_least64_t wmect_tmp = cts_update.call_duration - cts_update.call_time;
-		if (wmect_tmp > wmect)
-		{
-			wmect = wmect_tmp;
-			// RTT::log(RTT::Error) << "1[" << this->getName() << "] wmect: " << wmect << "ns, " << wmect * 1E-6 << "ms" << RTT::endlog();
-		}
+	out_call_trace_flush_port.setName("out_call_trace_flush_port");
+	out_call_trace_flush_port.doc("Output port for the flush ids, written after the remaining call trace samples in stopHook and cleanupHook");
+	out_call_trace_flush_port.setDataSample(0);
+	this->provides("introspection")->addPort(out_call_trace_flush_port);
 
-		// if (((cts_update.call_duration - cts_last_send) > cts_send_latest_after && !call_trace_storage.empty()) || (call_trace_storage.size() >= call_trace_storage_size)) {
-		// uint_least64_t ss = time_service->getNSecs();
+	in_call_trace_flush_ack_port.setName("in_call_trace_flush_ack_port");
+	in_call_trace_flush_ack_port.doc("Input port for the flush ids that the collector has received");
+	this->provides("introspection")->addPort(in_call_trace_flush_ack_port);
 
-		// bool done = false;
+	perf_ring.resize(call_trace_ring_size, CallTracePerfSample());
+	perf_storage.resize(call_trace_storage_size);
+	out_perf_counter_port.setName("out_perf_counter_port");
+	out_perf_counter_port.doc("Output port for the counter deltas of the traced updateHookInternal() calls, see usePerfCounters");
+	out_perf_counter_port.setDataSample(perf_storage);
+	this->provides("introspection")->addPort(out_perf_counter_port);
+	perf_storage.clear();
 
-		// Send once before an overflow will happen AND once per (ms) if required.
-		// Otherwise it may happen that the buffer will never get full before the application is shut down
-		// and we do not get any data.
-		// We also cannot wait until a component is stopped to send the collected data,
-		// because we do not know at that time whether or not the collector component is stopped or still running to receive the data samples.
-		if ((call_trace_storage.size() >= call_trace_storage_size) || (send_at_least_once_per_Xms > 0 && ((overhead_start - last_send) * 1E-6 >= send_at_least_once_per_Xms)))
-		{
-			// done = true;
-			// publish if the storage is full.
-			out_call_trace_sample_vec_port.write(call_trace_storage);
-			// cts_last_send = cts_update.call_duration;
-			call_trace_storage.clear();
+	causal_ring.resize(call_trace_ring_size, CallTraceCausalSample());
+	causal_storage.resize(call_trace_storage_size);
+	out_causal_trace_port.setName("out_causal_trace_port");
+	out_causal_trace_port.doc("Output port for the hops of the causal chains that reached this component, see useCausalTrace");
+	out_causal_trace_port.setDataSample(causal_storage);
+	this->provides("introspection")->addPort(out_causal_trace_port);
+	causal_storage.clear();
 
-			// Take the time from the actual sending point in time, or the  point in time when the updateHook() was called (overhead_start).
-			last_send = time_service->getNSecs();
-		}
-		call_trace_storage.push_back(cts_update);
+	out_latency_statistics_port.setName("out_latency_statistics_port");
+	out_latency_statistics_port.doc("Output port for the latency statistics in ns: updateHookInternal() p50, p99, p99.9, max, count, introspection overhead p50, p99, p99.9, max, count, start-to-start period jitter p50, p99, p99.9, max, count, deadline misses");
+	out_latency_statistics_port.setDataSample(latency_statistics);
+	this->provides("introspection")->addPort(out_latency_statistics_port);
 
-		// uint_least64_t ee = time_service->getNSecs();
-		// uint_least64_t diff = ee - ss;
-		// if (diff > wmectI) {
-		// 	wmectI = diff;
-		// 	RTT::log(RTT::Error) << "2[" << this->getName() << "] wmect: " << wmectI << "ns, " << wmectI * 1E-6 << "ms: done " << done << RTT::endlog();
-		// }
-		uint_least64_t overhead_end = time_service->getNSecs();
-		if (executionTimes.size() < executionTimes.capacity())
-		{
-			executionTimes.push_back(overhead_end - overhead_start);
-		}
-		// RTT::log(RTT::Fatal) << " [" << this->getName() << "] " << (overhead_end - overhead_start) << " " << wmect_tmp << RTT::endlog();
+	if (!trace_clock.setSource(useTSCClock ? RTTIntrospectionClock::CLOCK_SOURCE_TSC : RTTIntrospectionClock::CLOCK_SOURCE_TIMESERVICE))
+	{
+		RTT::log(RTT::Warning) << "[" << this->getName() << "] No invariant TSC available, using the RTT::os::TimeService for the call traces." << RTT::endlog();
 	}
-	else
+	wmect = 0;
+	call_trace_block_max_age = trace_clock.durationFromNSecs(send_at_least_once_per_Xms * 1000000);
+	call_trace_block_limit = block_size;
+	call_trace_block_capacity = block_size;
+	const double requested_probability = call_trace_sampler.probability;
+	if (!call_trace_sampler.configure(trace_clock.durationFromNSecs(1000000000ULL)))
 	{
-		updateHookInternal();
+		RTT::log(RTT::Warning) << "[" << this->getName() << "] call_trace_sampling_probability " << requested_probability << " is not 1/N with N >= 1, using " << call_trace_sampler.probability << "." << RTT::endlog();
 	}
-}
 
-bool RTTIntrospectionBase::startHook()
-{
-	bool startRet = false;
-	if (useCallTraceIntrospection)
+	// the calibration needs fixed blocks
+	const bool auto_batch = call_trace_batch_tuner.enabled;
+	call_trace_batch_tuner.enabled = false;
+	calibrateTracingOverhead();
+	call_trace_batch_tuner.enabled = auto_batch;
+	call_trace_events_stored = 0;
+	call_trace_batch_tuner.configure(static_cast<double>(trace_clock.durationFromNSecs(1000000)), 1, block_size, call_trace_block_pool.size());
+	call_trace_block_limit = block_size;
+	call_trace_cycles = 0;
+	if (call_trace_batch_tuner.enabled)
 	{
-		// start intro
-		cts_start.call_time = time_service->getNSecs();
-		cts_start.call_type = rstrt::monitoring::CallTraceSample::CALL_START_WITH_DURATION;
-		// out_call_trace_sample_port.write(cts_start);
+		call_trace_block_max_age = call_trace_batch_tuner.getMaxAge();
+	}
+	overhead_model.toNSecs(trace_clock, overhead_model_ns);
+	out_call_trace_overhead_port.setName("out_call_trace_overhead_port");
+	out_call_trace_overhead_port.doc("Output port for the tracing overhead model in ns: timestamp, store per event, flush per block, events per block. Calibrated in configureHook, then updated from the live measurements");
+	out_call_trace_overhead_port.setDataSample(overhead_model_ns);
+	this->provides("introspection")->addPort(out_call_trace_overhead_port);
+	out_call_trace_overhead_port.write(overhead_model_ns);
+	update_hook_histogram.reset();
+	overhead_histogram.reset();
+	period_jitter_histogram.reset();
+	trigger_latency_histogram.reset();
+	cpu_migrations.store(0, std::memory_order_relaxed);
+	cpu_off_affinity.store(0, std::memory_order_relaxed);
+	deadline_misses.store(0, std::memory_order_relaxed);
+	call_trace_ring_overflows = 0;
+	call_trace_storage_events = 0;
+	call_trace_batch_sequence = 0;
+	call_trace_events_sent = 0;
+	call_trace_accounting = Eigen::VectorXd::Zero(ACCOUNTING_SIZE);
+	call_trace_accounting(ACCOUNTING_COMPONENT_ID) = component_id;
+	out_call_trace_accounting_port.setName("out_call_trace_accounting_port");
+	out_call_trace_accounting_port.doc("Output port for the call trace event counters: component id, produced, dropped (block pool full), sent, batches. Written after each drained batch and before the flush id");
+	out_call_trace_accounting_port.setDataSample(call_trace_accounting);
+	this->provides("introspection")->addPort(out_call_trace_accounting_port);
 
-		// launch internal startHook
-		startRet = startHookInternal();
+	cts_last_send = 0;
 
-		// end intro
-		// cts_start.call_type = rstrt::monitoring::CallTraceSample::CALL_END;
-		cts_start.call_duration = time_service->getNSecs();
+	call_names_open = true;
+	if (!configureHookInternal())
+	{
+		call_names_open = false;
+		return false;
+	}
 
-		// Initialize the last_send with the actual time, so that we do not send at first sight (with time_service->getNSecs())
-		last_send = cts_start.call_duration;
+	// register the ports after configureHookInternal(), because components might create ports in there.
+	registerPortNames(this->provides());
+	// the names processCTS() did not know in the last run
+	collectUnknownCallNames();
+	for (const std::string &call_name : unknown_call_names)
+	{
+		call_names.registerName(call_name);
+	}
+	unknown_call_names.clear();
+	std::vector<std::pair<const void *, uint16_t>> trigger_entries;
+	if (useTriggerIntrospection)
+	{
+		registerTriggerPorts(this->provides(), trigger_entries);
+	}
+	trigger_table.assign(trigger_entries);
+	unregisterCausalPorts();
+	if (useCausalTrace)
+	{
+		registerCausalPorts(this->provides());
+	}
 
-		// out_call_trace_sample_port.write(cts_start);
-		// if (((cts_start.call_duration - cts_last_send) > cts_send_latest_after && !call_trace_storage.empty()) || (call_trace_storage.size() >= call_trace_storage_size)) {
-		if (call_trace_storage.size() >= call_trace_storage_size)
+	out_call_name_table_port.setName("out_call_name_table_port");
+	out_call_name_table_port.doc("Output port for the id to name table of the call trace samples. The index is the id. Written once in configureHook.");
+	out_call_name_table_port.setDataSample(call_names.getNames());
+	this->provides("introspection")->addPort(out_call_name_table_port);
+	out_call_name_table_port.write(call_names.getNames());
+	// all names are registered and the clock is calibrated, the blocks sent from now on carry this copy
+	call_trace_name_table = std::make_shared<const CallTraceNameTable>(call_names.getNames(), this->getName(), trace_clock);
+	call_names_open = false;
+
+	call_trace_shm.close();
+	if (useSharedMemoryTrace)
+	{
+		call_trace_shm_buffer.resize(block_size + 1);
+		if (!call_trace_shm.create(this->getName(), component_id, call_names.getNames(), call_trace_shm_size, time_service->getNSecs()))
 		{
-			// publish if the time limit has been passed or if the storage is full.
-			out_call_trace_sample_vec_port.write(call_trace_storage);
-			// cts_last_send = cts_start.call_duration;
-			call_trace_storage.clear();
+			RTT::log(RTT::Error) << "[" << this->getName() << "] Could not create the shared memory ring " << RTTIntrospectionShmRing::objectName(this->getName(), static_cast<uint32_t>(getpid())) << ", falling back to the output ports." << RTT::endlog();
 		}
-		call_trace_storage.push_back(cts_start);
-		return startRet;
 	}
-	else
+
+	trace_mask.resize(call_names.getNames().size());
+	applyTraceSelection(call_trace_selection);
+	trace_mask.update();
+
+	// sized for all names, so that the drain thread never allocates
+	call_trace_summary.configure(call_names.getNames().size(), trace_clock.durationFromNSecs(static_cast<uint_least64_t>(call_trace_summary_period * 1E9)), trace_clock.now());
+	call_trace_summary_records.resize(call_names.getNames().size());
+	out_call_trace_summary_port.setName("out_call_trace_summary_port");
+	out_call_trace_summary_port.doc("Output port for the per port and hook counters and duration statistics (ns) of each call_trace_summary_period, see call_trace_summary_mode. The names are published on out_call_name_table_port");
+	out_call_trace_summary_port.setDataSample(call_trace_summary_records);
+	this->provides("introspection")->addPort(out_call_trace_summary_port);
+	call_trace_summary_records.clear();
+	call_trace_summary_active = call_trace_summary_mode;
+
+	if (useMemoryLock)
 	{
-		return startHookInternal();
+		lockIntrospectionMemory();
+	}
+
+	if (useCallTraceIntrospection)
+	{
+		cte_configure.call_time = trace_clock.fromNSecs(configure_start);
+		cte_configure.call_type = rstrt::monitoring::CallTraceSample::CALL_START_WITH_DURATION;
+		cte_configure.call_duration = trace_clock.now();
+		storeCallTraceEvent(cte_configure);
 	}
+	return true;
 }
 
-void RTTIntrospectionBase::writeDebugInformation()
+void RTTIntrospectionBase::registerPortNames(RTT::Service::shared_ptr service)
 {
-	std::ofstream myfile;
-	myfile.open(this->getName() + "-executionTime_" + std::to_string(time_service->getNSecs()) + ".csv");
+	for (RTT::base::PortInterface *port : service->getPorts())
+	{
+		registerPortName(port);
+	}
+	for (const std::string &provider : service->getProviderNames())
+	{
+		registerPortNames(service->getService(provider));
+	}
+}
+
+uint16_t RTTIntrospectionBase::registerPortName(const RTT::base::PortInterface *port)
+{
+	const uint16_t id = call_names.registerName(port->getName());
+	port_name_ids[port] = id;
+	return id;
+}
 
-	bool first = true;
-	for (uint_least64_t cts : executionTimes)
+void RTTIntrospectionBase::registerTriggerPorts(RTT::Service::shared_ptr service, std::vector<std::pair<const void *, uint16_t>> &entries)
+{
+	for (RTT::base::PortInterface *port : service->getPorts())
 	{
-		if (first)
+		// only ports added with addEventPort reach dataOnPortHook, the slots of the others stay empty
+		if (dynamic_cast<RTT::base::InputPortInterface *>(port))
 		{
-			first = false;
-			myfile << cts;
+			entries.push_back(std::make_pair(static_cast<const void *>(port), call_names.registerName(TRIGGER_NAME_PREFIX + port->getName() + ")")));
 		}
-		else
+	}
+	for (const std::string &provider : service->getProviderNames())
+	{
+		// the acknowledgements of the flush handshake do not wake updateHook
+		if (provider != "introspection")
 		{
-			myfile << ",\n"
-				   << cts;
+			registerTriggerPorts(service->getService(provider), entries);
 		}
 	}
-	myfile.close();
-
-	RTT::log(RTT::Error) << "END [" << this->getName() << "] WMECT: " << wmect << "ns (" << wmect * 1E-6 << "ms)" << RTT::endlog();
 }
 
-void RTTIntrospectionBase::stopHook()
+void RTTIntrospectionBase::registerCausalPorts(RTT::Service::shared_ptr service)
 {
-	if (useCallTraceIntrospection)
+	for (RTT::base::PortInterface *port : service->getPorts())
+	{
+		RTTIntrospectionCausalPort &causal_port = causal_ports[port];
+		causal_port.source = RTTIntrospectionCausalRegistry::instance().registerSource(port, this->getName() + "." + port->getName());
+		if (dynamic_cast<RTT::base::OutputPortInterface *>(port))
+		{
+			causal_port.slot = RTTIntrospectionCausalRegistry::instance().getSlot(causal_port.source);
+		}
+	}
+	for (const std::string &provider : service->getProviderNames())
 	{
-		// // start intro
-		// cts_stop.call_time = time_service->getNSecs();
-		// cts_stop.call_type = rstrt::monitoring::CallTraceSample::CALL_START_WITH_DURATION;
-		// // out_call_trace_sample_port.write(cts_stop);
+		// the introspection ports are not part of the pipelines
+		if (provider != "introspection")
+		{
+			registerCausalPorts(service->getService(provider));
+		}
+	}
+}
 
-		// launch internal stopHook
-		stopHookInternal();
+void RTTIntrospectionBase::unregisterCausalPorts()
+{
+	for (std::pair<const RTT::base::PortInterface *const, RTTIntrospectionCausalPort> &causal_port : causal_ports)
+	{
+		if (causal_port.second.source > 0)
+		{
+			RTTIntrospectionCausalRegistry::instance().unregisterSource(causal_port.first);
+		}
+		causal_port.second = RTTIntrospectionCausalPort();
+	}
+}
 
-		// // end intro
-		// // cts_stop.call_type = rstrt::monitoring::CallTraceSample::CALL_END;
-		// cts_stop.call_duration = time_service->getNSecs();
-
-		// // out_call_trace_sample_port.write(cts_stop);
-		// if (call_trace_storage.size() >= call_trace_storage_size) {
-		// 	out_call_trace_sample_vec_port.write(call_trace_storage);
-		// 	call_trace_storage.clear();
-		// 	call_trace_storage.push_back(cts_stop);
-		// 	// might be too fast!!!
-		// 	out_call_trace_sample_vec_port.write(call_trace_storage);
-		// } else {
-		// 	call_trace_storage.push_back(cts_stop);
-		// 	out_call_trace_sample_vec_port.write(call_trace_storage);
-		// }
-		// cts_last_send = cts_stop.call_duration;
-		// call_trace_storage.clear();
-		if (auto_write_execution_information)
+void RTTIntrospectionBase::resolveCausalUpstream(RTT::Service::shared_ptr service)
+{
+	for (RTT::base::PortInterface *port : service->getPorts())
+	{
+		std::map<const RTT::base::PortInterface *, RTTIntrospectionCausalPort>::iterator it = causal_ports.find(port);
+		if (it == causal_ports.end() || !dynamic_cast<RTT::base::InputPortInterface *>(port))
 		{
-			writeDebugInformation();
+			continue;
+		}
+		it->second.upstream_source = 0;
+		it->second.upstream = 0;
+		// the first data connection to an output port of a component in this process, remote connections start a new chain
+		for (const RTT::internal::ConnectionManager::ChannelDescriptor &descriptor : port->getManager()->getConnections())
+		{
+			const RTT::internal::LocalConnID *conn_id = dynamic_cast<const RTT::internal::LocalConnID *>(descriptor.get<0>().get());
+			const uint32_t upstream_source = conn_id ? RTTIntrospectionCausalRegistry::instance().findSource(conn_id->ptr) : 0;
+			if (upstream_source > 0 && descriptor.get<2>().type != RTT::ConnPolicy::DATA)
+			{
+				RTT::log(RTT::Warning) << "[" << this->getName() << "] The causal context is only propagated over data connections, " << port->getName() << " starts a new chain for its buffered connection to " << RTTIntrospectionCausalRegistry::instance().getName(upstream_source) << "." << RTT::endlog();
+				continue;
+			}
+			if (upstream_source > 0)
+			{
+				it->second.upstream_source = upstream_source;
+				it->second.upstream = RTTIntrospectionCausalRegistry::instance().getSlot(upstream_source);
+				break;
+			}
 		}
 	}
-	else
+	for (const std::string &provider : service->getProviderNames())
 	{
-		stopHookInternal();
+		if (provider != "introspection")
+		{
+			resolveCausalUpstream(service->getService(provider));
+		}
 	}
 }
 
-void RTTIntrospectionBase::cleanupHook()
+void RTTIntrospectionBase::traceCausalRead(const RTTIntrospectionCausalPort &causal_port)
 {
-	cts_send_latest_after = UINT_LEAST64_MAX;
-	cleanupHookInternal();
+	if (!causal_port.upstream)
+	{
+		return;
+	}
+	CausalContext context;
+	CallTraceCausalSample sample;
+	if (!causal_port.upstream->read(context, sample.write_time))
+	{
+		return;
+	}
+	sample.sequence = context.sequence;
+	sample.origin_time = context.origin_time;
+	// time service ns, from the trace clock
+	sample.read_time = trace_clock.toNSecs(trace_clock.now());
+	sample.origin_source = context.origin_source;
+	sample.upstream_source = causal_port.upstream_source;
+	sample.reader_source = causal_port.source;
+	sample.component_id = static_cast<uint16_t>(component_id);
+	sample.reserved = 0;
+	causal_ring.push(sample);
+	// the oldest origin bounds the end-to-end latency of everything written in this cycle
+	if (causal_context.sequence == 0 || context.origin_time < causal_context.origin_time)
+	{
+		causal_context = context;
+	}
 }
 
-void RTTIntrospectionBase::setCallTraceStorageSize(const int size)
+void RTTIntrospectionBase::traceCausalWrite(const RTTIntrospectionCausalPort &causal_port)
 {
-	call_trace_storage_size = size;
-	call_trace_storage.clear();
-	call_trace_storage.reserve(call_trace_storage_size);
+	if (!causal_port.slot)
+	{
+		return;
+	}
+	const uint64_t now = trace_clock.toNSecs(trace_clock.now());
+	if (causal_context.sequence == 0)
+	{
+		CausalContext origin;
+		origin.sequence = RTTIntrospectionCausalRegistry::instance().nextSequence();
+		origin.origin_time = now;
+		origin.origin_source = causal_port.source;
+		causal_port.slot->write(origin, now);
+		return;
+	}
+	causal_port.slot->write(causal_context, now);
 }
 
-uint_least64_t RTTIntrospectionBase::getWMECT()
+bool RTTIntrospectionBase::dataOnPortHook(RTT::base::PortInterface *port)
 {
-	return wmect;
+	if (trigger_table.isArmed())
+	{
+		trigger_table.mark(port, trace_clock.now());
+	}
+	return RTT::TaskContext::dataOnPortHook(port);
 }
 
-void RTTIntrospectionBase::setWMECT(const uint_least64_t wmect)
+uint16_t RTTIntrospectionBase::registerCallName(const std::string &call_name)
 {
-	this->wmect = wmect;
+	return call_names.registerName(call_name);
 }
 
-void RTTIntrospectionBase::processCTS(rstrt::monitoring::CallTraceSample &cts)
+void RTTIntrospectionBase::updateHook()
 {
-	if (call_trace_storage.size() >= call_trace_storage_size)
+	// at the cycle boundary, before anything reads the settings
+	adoptIntrospectionSettings();
+	uint_least64_t overhead_start = trace_clock.now();
+	causal_context = CausalContext();
+	if (useCallTraceIntrospection)
 	{
-		// done = true;
-		// publish if the storage is full.
-		out_call_trace_sample_vec_port.write(call_trace_storage);
-		// cts_last_send = cts_update.call_duration;
-		call_trace_storage.clear();
+		cte_update.call_time = trace_clock.now();
+		cte_update.call_type = rstrt::monitoring::CallTraceSample::CALL_START_WITH_DURATION;
+
+		// two back to back timestamps
+		overhead_model.updateTimestamp(cte_update.call_time - overhead_start);
+		call_trace_cycle_sampled = call_trace_sampler.sampleCycle(cte_update.call_time, call_trace_events_stored);
+		call_trace_cycle_factor = call_trace_sampler.getFactor();
+		// scopes that were not closed in the last cycle are dropped
+		trace_scope_depth = 0;
+		trace_mask.update();
+		if (call_trace_summary_active)
+		{
+			call_trace_summary.rotate(cte_update.call_time);
+		}
+
+		const bool perf_sampled = usePerfCounters && call_trace_cycle_sampled;
+		if (perf_sampled)
+		{
+			if (!perf_counters_opened)
+			{
+				// once, in the thread of the activity, a failure is reported by closePerfCounters()
+				perf_counters_opened = true;
+				perf_counters.open();
+			}
+			perf_counters.read(perf_counters_start);
+			// do not count the system call as part of updateHook
+			cte_update.call_time = trace_clock.now();
+		}
+
+		if (trigger_table.isArmed())
+		{
+			const bool sampled = call_trace_cycle_sampled;
+			const uint_least64_t update_start = cte_update.call_time;
+			trigger_table.collect(update_start, [this, sampled, update_start](const uint16_t call_name_id, const uint_least64_t first_write) {
+				trigger_latency_histogram.record(update_start - first_write);
+				if (sampled)
+				{
+					CallTraceEvent cte_trigger;
+					cte_trigger.call_name_id = call_name_id;
+					cte_trigger.call_type = rstrt::monitoring::CallTraceSample::CALL_START_WITH_DURATION;
+					cte_trigger.call_time = first_write;
+					cte_trigger.call_duration = update_start;
+					cte_trigger.sampling_factor = call_trace_cycle_factor;
+					storeCallTraceEvent(cte_trigger);
+				}
+			});
+		}
+
+		const int cpu_start = useCpuTrace ? sched_getcpu() : -1;
+
+		recordPeriodJitter(cte_update.call_time);
+
+		// launch internal updateHook
+		updateHookInternal();
+
+		cte_update.call_duration = trace_clock.now();
+		const int cpu_end = useCpuTrace ? sched_getcpu() : -1;
+		if (useCpuTrace)
+		{
+			countCpuMigrations(cpu_start, cpu_end);
+		}
+		if (perf_sampled || (useCpuTrace && call_trace_cycle_sampled))
+		{
+			CallTracePerfSample perf_sample;
+			if (perf_sampled)
+			{
+				perf_counters.read(perf_sample.values);
+				for (unsigned int i = 0; i < PERF_COUNTER_COUNT; i++)
+				{
+					perf_sample.values[i] -= perf_counters_start[i];
+				}
+				perf_sample.source = perf_counters.getSource();
+				perf_sample.valid = perf_counters.getValid();
+			}
+			else
+			{
+				std::fill(perf_sample.values, perf_sample.values + PERF_COUNTER_COUNT, 0);
+				perf_sample.source = RTTIntrospectionPerfCounters::SOURCE_NONE;
+				perf_sample.valid = 0;
+			}
+			perf_sample.call_time = cte_update.call_time;
+			perf_sample.call_duration = cte_update.call_duration - cte_update.call_time;
+			perf_sample.component_id = static_cast<uint16_t>(component_id);
+			perf_sample.cpu_start = static_cast<int16_t>(cpu_start);
+			perf_sample.cpu_end = static_cast<int16_t>(cpu_end);
+			perf_sample.sampling_factor = call_trace_cycle_factor;
+			perf_ring.push(perf_sample);
+		}
+		uint_least64_t wmect_tmp = cte_update.call_duration - cte_update.call_time;
+		update_hook_histogram.record(wmect_tmp);
+		if (wmect_tmp > wmect)
+		{
+			wmect = wmect_tmp;
+			// RTT::log(RTT::Error) << "1[" << this->getName() << "] wmect: " << wmect << "ns, " << wmect * 1E-6 << "ms" << RTT::endlog();
+		}
+
+		if (call_trace_cycle_sampled)
+		{
+			call_trace_cycles++;
+			cte_update.sampling_factor = call_trace_cycle_factor;
+			if (++overhead_update_counter >= OVERHEAD_UPDATE_INTERVAL)
+			{
+				overhead_update_counter = 0;
+				const uint_least64_t store_start = trace_clock.now();
+				storeCallTraceEvent(cte_update);
+				overhead_model.updateStore(trace_clock.now() - store_start);
+			}
+			else
+			{
+				storeCallTraceEvent(cte_update);
+			}
+		}
+		// do not keep a partially filled block forever
+		if (call_trace_block && call_trace_block_max_age > 0 && cte_update.call_duration - call_trace_block_start >= call_trace_block_max_age)
+		{
+			publishCallTraceBlock();
+		}
+		// port accesses outside of updateHook are always traced
+		call_trace_cycle_sampled = true;
+		call_trace_cycle_factor = 1;
+
+		if (countDeadlineMiss(wmect_tmp))
+		{
+			cte_deadline_miss.call_time = cte_update.call_time;
+			cte_deadline_miss.call_duration = cte_update.call_duration;
+			storeCallTraceEvent(cte_deadline_miss);
+		}
+
+		// uint_least64_t ee = time_service->getNSecs();
+		// uint_least64_t diff = ee - ss;
+		// if (diff > wmectI) {
+		// 	wmectI = diff;
+		// 	RTT::log(RTT::Error) << "2[" << this->getName() << "] wmect: " << wmectI << "ns, " << wmectI * 1E-6 << "ms: done " << done << RTT::endlog();
+		// }
+		uint_least64_t overhead_end = trace_clock.now();
+		if (executionTimes.size() < executionTimes.capacity())
+		{
+			executionTimes.push_back(overhead_end - overhead_start);
+		}
+		overhead_histogram.record((overhead_end - overhead_start) - wmect_tmp);
+		// RTT::log(RTT::Fatal) << " [" << this->getName() << "] " << (overhead_end - overhead_start) << " " << wmect_tmp << RTT::endlog();
+	}
+	else
+	{
+		// do not report stale writes once the introspection is enabled again
+		if (trigger_table.isArmed())
+		{
+			trigger_table.collect(UINT_LEAST64_MAX, [](const uint16_t, const uint_least64_t) {});
+		}
+		// the jitter and the deadline misses are monitored without the call traces, at the cost of two timestamps
+		if (activity_period > 0)
+		{
+			const uint_least64_t update_start = trace_clock.now();
+			recordPeriodJitter(update_start);
+			updateHookInternal();
+			countDeadlineMiss(trace_clock.now() - update_start);
+		}
+		else
+		{
+			updateHookInternal();
+		}
+	}
+}
+
+bool RTTIntrospectionBase::startHook()
+{
+	bool startRet = false;
+	adoptIntrospectionSettings();
+	// the connections are usually made after configureHook
+	if (useCausalTrace)
+	{
+		resolveCausalUpstream(this->provides());
+	}
+	if (useCallTraceIntrospection)
+	{
+		// start intro
+		cte_start.call_time = trace_clock.now();
+		cte_start.call_type = rstrt::monitoring::CallTraceSample::CALL_START_WITH_DURATION;
+		// out_call_trace_sample_port.write(cts_start);
+
+		// launch internal startHook
+		startRet = startHookInternal();
+
+		// end intro
+		// cts_start.call_type = rstrt::monitoring::CallTraceSample::CALL_END;
+		cte_start.call_duration = trace_clock.now();
+
+		// Initialize the last_send with the actual time, so that we do not send at first sight (with time_service->getNSecs())
+		last_send = time_service->getNSecs();
+
+		storeCallTraceEvent(cte_start);
+		resetPeriodMonitoring();
+		call_trace_drain_enabled = true;
+		updateCallTraceDrain(useCallTraceIntrospection);
+		return startRet;
+	}
+	else
+	{
+		last_send = time_service->getNSecs();
+		resetPeriodMonitoring();
+		call_trace_drain_enabled = true;
+		updateCallTraceDrain(useCallTraceIntrospection);
+		return startHookInternal();
+	}
+}
+
+void RTTIntrospectionBase::writeDebugInformation()
+{
+	// the copy is handed over to the writer thread, the file is written in the background
+	std::vector<uint64_t> values(executionTimes.begin(), executionTimes.end());
+	const uint_least64_t now = time_service->getNSecs();
+	debug_information_writer.dump(this->getName() + "-executionTime_" + std::to_string(now) + ".bin", values, trace_clock.getNSecsPerTick(), now);
+
+	RTT::log(RTT::Error) << "END [" << this->getName() << "] WMECT: " << getWMECT() << "ns (" << getWMECT() * 1E-6 << "ms)" << RTT::endlog();
+	printLatencyStatistics();
+}
+
+void RTTIntrospectionBase::stopHook()
+{
+	trigger_table.arm(false);
+	adoptIntrospectionSettings();
+	if (useCallTraceIntrospection)
+	{
+		cte_stop.call_time = trace_clock.now();
+		cte_stop.call_type = rstrt::monitoring::CallTraceSample::CALL_START_WITH_DURATION;
+
+		// launch internal stopHook
+		stopHookInternal();
+
+		cte_stop.call_duration = trace_clock.now();
+		storeCallTraceEvent(cte_stop);
+
+		// nothing traced so far gets lost, regardless of the batch size
+		flushCallTraces();
+		closePerfCounters();
+		if (call_trace_ring_overflows > 0)
+		{
+			RTT::log(RTT::Warning) << "[" << this->getName() << "] Dropped " << call_trace_ring_overflows << " call trace samples, because the ring was full. Consider increasing call_trace_ring_size." << RTT::endlog();
+		}
+		if (auto_write_execution_information)
+		{
+			writeDebugInformation();
+		}
+	}
+	else
+	{
+		stopHookInternal();
+		flushCallTraces();
+		closePerfCounters();
+	}
+}
+
+void RTTIntrospectionBase::closePerfCounters()
+{
+	if (perf_counters_opened && perf_counters.getSource() == RTTIntrospectionPerfCounters::SOURCE_NONE)
+	{
+		RTT::log(RTT::Warning) << "[" << this->getName() << "] Neither perf events nor getrusage were available, the perf samples carry no counters." << RTT::endlog();
+	}
+	perf_counters.close();
+	perf_counters_opened = false;
+}
+
+void RTTIntrospectionBase::cleanupHook()
+{
+	cts_send_latest_after = UINT_LEAST64_MAX;
+	if (useCallTraceIntrospection)
+	{
+		cte_cleanup.call_time = trace_clock.now();
+		cte_cleanup.call_type = rstrt::monitoring::CallTraceSample::CALL_START_WITH_DURATION;
+
+		cleanupHookInternal();
+
+		cte_cleanup.call_duration = trace_clock.now();
+		storeCallTraceEvent(cte_cleanup);
+	}
+	else
+	{
+		cleanupHookInternal();
+	}
+	flushCallTraces();
+	releaseQueuedCallTraceBlocks();
+	call_trace_shm.close();
+}
+
+void RTTIntrospectionBase::setCallTraceStorageSize(const int size)
+{
+	const std::size_t storage_size = size > 0 ? size : 1;
+	// allocated here, the drain thread only swaps the vectors
+	storage_handover.update([storage_size](RTTIntrospectionDrainStorage &storage) {
+		storage = RTTIntrospectionDrainStorage();
+		storage.size = storage_size;
+		storage.samples.reserve(storage_size);
+		storage.records.reserve(storage_size);
+		storage.perf.reserve(storage_size);
+		storage.causal.reserve(storage_size);
+	});
+	settings_handover.update([storage_size](RTTIntrospectionSettings &settings) {
+		settings.changed |= RTTIntrospectionSettings::BLOCK_LIMIT;
+		settings.block_limit = storage_size;
+	});
+	storage_size_setting->mirror(storage_size);
+	if (storage_size > call_trace_block_capacity && this->isRunning())
+	{
+		RTT::log(RTT::Info) << "[" << this->getName() << "] The call trace blocks keep " << call_trace_block_capacity << " events until the next configureHook, the batches of the drain thread have " << storage_size << "." << RTT::endlog();
+	}
+}
+
+uint_least64_t RTTIntrospectionBase::getWMECT()
+{
+	return trace_clock.durationToNSecs(wmect);
+}
+
+void RTTIntrospectionBase::setWMECT(const uint_least64_t wmect)
+{
+	this->wmect = trace_clock.durationFromNSecs(wmect);
+}
+
+uint_least64_t RTTIntrospectionBase::getUpdateHookLatencyPercentile(const double percentile)
+{
+	return trace_clock.durationToNSecs(update_hook_histogram.getPercentile(percentile));
+}
+
+uint_least64_t RTTIntrospectionBase::getIntrospectionOverheadPercentile(const double percentile)
+{
+	return trace_clock.durationToNSecs(overhead_histogram.getPercentile(percentile));
+}
+
+uint_least64_t RTTIntrospectionBase::getPeriodJitterPercentile(const double percentile)
+{
+	return trace_clock.durationToNSecs(period_jitter_histogram.getPercentile(percentile));
+}
+
+uint_least64_t RTTIntrospectionBase::getTriggerLatencyPercentile(const double percentile)
+{
+	return trace_clock.durationToNSecs(trigger_latency_histogram.getPercentile(percentile));
+}
+
+void RTTIntrospectionBase::countCpuMigrations(const int cpu_start, const int cpu_end)
+{
+	if (cpu_start < 0)
+	{
+		return;
+	}
+	// single writer, a load and a store instead of a locked increment
+	uint_least64_t migrations = cpu_migrations.load(std::memory_order_relaxed);
+	if (cpu_end != cpu_start)
+	{
+		migrations++;
+	}
+	const int previous_cpu = last_cpu.load(std::memory_order_relaxed);
+	if (previous_cpu >= 0 && cpu_start != previous_cpu)
+	{
+		migrations++;
+	}
+	cpu_migrations.store(migrations, std::memory_order_relaxed);
+	last_cpu.store(cpu_end, std::memory_order_relaxed);
+	// ~0 (or 0) means no pinning
+	if (cpu_affinity != 0 && cpu_affinity != ~0u && (cpu_start >= 32 || !(cpu_affinity & (1u << cpu_start))))
+	{
+		cpu_off_affinity.store(cpu_off_affinity.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+}
+
+uint_least64_t RTTIntrospectionBase::getCpuMigrations()
+{
+	return cpu_migrations.load(std::memory_order_relaxed);
+}
+
+uint_least64_t RTTIntrospectionBase::getCpuOffAffinity()
+{
+	return cpu_off_affinity.load(std::memory_order_relaxed);
+}
+
+uint_least64_t RTTIntrospectionBase::getDeadlineMisses()
+{
+	return deadline_misses.load(std::memory_order_relaxed);
+}
+
+void RTTIntrospectionBase::resetPeriodMonitoring()
+{
+	last_update_start = 0;
+	activity_period = 0;
+	if (this->getActivity() && this->getActivity()->getPeriod() > 0)
+	{
+		activity_period = trace_clock.durationFromNSecs(static_cast<uint_least64_t>(this->getActivity()->getPeriod() * 1E9));
+	}
+	last_cpu.store(-1, std::memory_order_relaxed);
+	cpu_affinity = 0;
+	if (this->getActivity())
+	{
+		cpu_affinity = this->getActivity()->getCpuAffinity();
+	}
+	// a periodic activity is not woken up by the ports
+	trigger_table.collect(UINT_LEAST64_MAX, [](const uint16_t, const uint_least64_t) {});
+	trigger_table.arm(activity_period == 0);
+}
+
+void RTTIntrospectionBase::updateLatencyStatistics(Eigen::VectorXd &statistics)
+{
+	const RTTIntrospectionHistogram *histograms[3] = {&update_hook_histogram, &overhead_histogram, &period_jitter_histogram};
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		statistics(i * 5 + 0) = trace_clock.durationToNSecs(histograms[i]->getPercentile(50.0));
+		statistics(i * 5 + 1) = trace_clock.durationToNSecs(histograms[i]->getPercentile(99.0));
+		statistics(i * 5 + 2) = trace_clock.durationToNSecs(histograms[i]->getPercentile(99.9));
+		statistics(i * 5 + 3) = trace_clock.durationToNSecs(histograms[i]->getMax());
+		statistics(i * 5 + 4) = histograms[i]->getCount();
+	}
+	statistics(15) = deadline_misses.load(std::memory_order_relaxed);
+}
+
+void RTTIntrospectionBase::printLatencyStatistics()
+{
+	Eigen::VectorXd statistics(LATENCY_STATISTICS_SIZE);
+	updateLatencyStatistics(statistics);
+	RTT::log(RTT::Warning) << "[" << this->getName() << "] updateHookInternal() ns: p50 " << statistics(0) << ", p99 " << statistics(1) << ", p99.9 " << statistics(2) << ", max " << statistics(3) << " (" << statistics(4) << " samples)" << RTT::endlog();
+	RTT::log(RTT::Warning) << "[" << this->getName() << "] introspection overhead ns: p50 " << statistics(5) << ", p99 " << statistics(6) << ", p99.9 " << statistics(7) << ", max " << statistics(8) << " (" << statistics(9) << " samples)" << RTT::endlog();
+	if (activity_period > 0)
+	{
+		RTT::log(RTT::Warning) << "[" << this->getName() << "] period jitter ns: p50 " << statistics(10) << ", p99 " << statistics(11) << ", p99.9 " << statistics(12) << ", max " << statistics(13) << " (" << statistics(14) << " samples), deadline misses " << statistics(15) << RTT::endlog();
+	}
+	if (useCpuTrace)
+	{
+		RTT::log(RTT::Warning) << "[" << this->getName() << "] last cpu " << last_cpu.load(std::memory_order_relaxed) << ", migrations " << cpu_migrations.load(std::memory_order_relaxed) << ", updateHook calls outside of the cpu affinity " << cpu_off_affinity.load(std::memory_order_relaxed) << RTT::endlog();
+	}
+	if (trigger_latency_histogram.getCount() > 0)
+	{
+		RTT::log(RTT::Warning) << "[" << this->getName() << "] trigger latency ns: p50 " << trace_clock.durationToNSecs(trigger_latency_histogram.getPercentile(50.0)) << ", p99 " << trace_clock.durationToNSecs(trigger_latency_histogram.getPercentile(99.0)) << ", p99.9 " << trace_clock.durationToNSecs(trigger_latency_histogram.getPercentile(99.9)) << ", max " << trace_clock.durationToNSecs(trigger_latency_histogram.getMax()) << " (" << trigger_latency_histogram.getCount() << " triggers)" << RTT::endlog();
+	}
+	if (call_trace_batch_tuner.enabled)
+	{
+		RTT::log(RTT::Warning) << "[" << this->getName() << "] auto batch: " << call_trace_batch_tuner.getBatchSize() << " events, max age " << trace_clock.durationToNSecs(call_trace_batch_tuner.getMaxAge()) << "ns, drain latency " << call_trace_batch_tuner.getDrainLatency() * trace_clock.getNSecsPerTick() << "ns" << RTT::endlog();
+	}
+	Eigen::VectorXd model;
+	overhead_model.toNSecs(trace_clock, model);
+	RTT::log(RTT::Warning) << "[" << this->getName() << "] tracing overhead model ns: timestamp " << model(RTTIntrospectionOverheadModel::MODEL_TIMESTAMP) << ", store " << model(RTTIntrospectionOverheadModel::MODEL_STORE) << " per event, flush " << model(RTTIntrospectionOverheadModel::MODEL_FLUSH) << " per " << model(RTTIntrospectionOverheadModel::MODEL_EVENTS_PER_FLUSH) << " events" << RTT::endlog();
+}
+
+void RTTIntrospectionBase::calibrateTracingOverhead()
+{
+	static const unsigned int rounds = 16;
+	static const unsigned int timestamps = 1000;
+	// stay below the block size, so that the block is only published where it is timed
+	const std::size_t events = call_trace_storage_size > 1 ? call_trace_storage_size - 1 : 1;
+
+	CallTraceEvent cte;
+	cte.call_name_id = RTTIntrospectionNameRegistry::UNREGISTERED_ID;
+	volatile uint_least64_t sink = 0;
+	// minimum of all rounds, so that preemptions during the calibration do not count
+	double timestamp = std::numeric_limits<double>::max();
+	double store = std::numeric_limits<double>::max();
+	double flush = std::numeric_limits<double>::max();
+	for (unsigned int round = 0; round < rounds; round++)
+	{
+		const uint_least64_t t0 = trace_clock.now();
+		for (unsigned int i = 0; i < timestamps; i++)
+		{
+			sink = sink + trace_clock.now();
+		}
+		const uint_least64_t t1 = trace_clock.now();
+		timestamp = std::min(timestamp, static_cast<double>(t1 - t0) / timestamps);
+
+		releaseQueuedCallTraceBlocks();
+		const uint_least64_t t2 = trace_clock.now();
+		for (std::size_t i = 0; i < events; i++)
+		{
+			cte.call_time = t2;
+			storeCallTraceEvent(cte);
+		}
+		const uint_least64_t t3 = trace_clock.now();
+		if (call_trace_block)
+		{
+			publishCallTraceBlock();
+		}
+		const uint_least64_t t4 = trace_clock.now();
+		store = std::min(store, static_cast<double>(t3 - t2) / events);
+		flush = std::min(flush, static_cast<double>(t4 - t3));
+	}
+	releaseQueuedCallTraceBlocks();
+	call_trace_ring_overflows = 0;
+
+	flush = flush > timestamp ? flush - timestamp : 0;
+	overhead_model.setCalibration(timestamp, store, flush, call_trace_storage_size);
+	RTT::log(RTT::Info) << "[" << this->getName() << "] Tracing overhead: timestamp " << timestamp * trace_clock.getNSecsPerTick() << "ns, store " << store * trace_clock.getNSecsPerTick() << "ns per event, flush " << flush * trace_clock.getNSecsPerTick() << "ns per block" << RTT::endlog();
+}
+
+void RTTIntrospectionBase::processCTS(rstrt::monitoring::CallTraceSample &cts)
+{
+	CallTraceEvent cte;
+	cte.sampling_factor = call_trace_cycle_factor;
+	cte.call_time = trace_clock.fromNSecs(cts.call_time);
+	cte.call_duration = cts.call_duration > 0 ? trace_clock.fromNSecs(cts.call_duration) : 0;
+	cte.call_name_id = call_names_open ? call_names.registerName(cts.call_name) : call_names.findName(cts.call_name);
+	if (cte.call_name_id == RTTIntrospectionNameRegistry::UNREGISTERED_ID && cts.call_name.size() <= UNKNOWN_CALL_NAME_LENGTH)
+	{
+		// fits into the reserved strings of the ring, so the copy does not allocate
+		unknown_call_name_ring.push(cts.call_name);
+	}
+	cte.call_type = cts.call_type;
+	storeCallTraceEvent(cte);
+}
+
+void RTTIntrospectionBase::startCallTraceDrain()
+{
+	std::lock_guard<std::mutex> lock(call_trace_drain_mutex);
+	// checked under the lock, so that flushCallTraces() can not miss a thread started by an operation
+	if (!call_trace_drain_enabled.load() || call_trace_drain_running.exchange(true))
+	{
+		return;
+	}
+	call_trace_drain_thread = std::thread(&RTTIntrospectionBase::drainCallTraceRing, this);
+}
+
+void RTTIntrospectionBase::stopCallTraceDrain()
+{
+	std::lock_guard<std::mutex> lock(call_trace_drain_mutex);
+	call_trace_drain_running.store(false);
+	if (call_trace_drain_thread.joinable())
+	{
+		call_trace_drain_thread.join();
+	}
+}
+
+void RTTIntrospectionBase::updateCallTraceDrain(const bool call_trace)
+{
+	// the drain thread also publishes the latency statistics, overhead and accounting ports,
+	// so keep it running for them even without call traces or causal hops
+	if (call_trace || useCausalTrace || latency_statistics_period > 0)
+	{
+		startCallTraceDrain();
+	}
+	else
+	{
+		stopCallTraceDrain();
+	}
+}
+
+void RTTIntrospectionBase::flushCallTraces()
+{
+	call_trace_drain_enabled = false;
+	stopCallTraceDrain();
+	call_trace_flushing = out_call_trace_flush_port.connected() && in_call_trace_flush_ack_port.connected();
+	call_trace_flush_deadline = time_service->getNSecs() + static_cast<uint_least64_t>(call_trace_flush_timeout * 1E9);
+	if (call_trace_block)
+	{
+		publishCallTraceBlock();
+	}
+	if (call_trace_summary_active)
+	{
+		// hand the current interval over as well
+		publishCallTraceSummary();
+		call_trace_summary.rotate(trace_clock.now(), true);
+	}
+	// the drain thread is stopped, so this thread may consume the blocks
+	drainCallTraceBlocks(true);
+
+	if (call_trace_shm.isOpen() && call_trace_shm.hasCollector())
+	{
+		const uint_least64_t shm_flush_start = time_service->getNSecs();
+		while (call_trace_shm.pending() > 0 && (time_service->getNSecs() - shm_flush_start) * 1E-9 < call_trace_flush_timeout)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		if (call_trace_shm.pending() > 0)
+		{
+			RTT::log(RTT::Warning) << "[" << this->getName() << "] The collector did not read the shared memory ring within " << call_trace_flush_timeout << "s." << RTT::endlog();
+		}
+	}
+
+	if (call_trace_flushing)
+	{
+		// written after the samples, so the collector has everything once it sees the id
+		requestCallTraceFlushAck();
+	}
+	call_trace_flushing = false;
+}
+
+bool RTTIntrospectionBase::requestCallTraceFlushAck()
+{
+	call_trace_flush_id++;
+	out_call_trace_flush_port.write(call_trace_flush_id);
+
+	uint_least64_t ack = 0;
+	while (static_cast<uint_least64_t>(time_service->getNSecs()) < call_trace_flush_deadline)
+	{
+		if (in_call_trace_flush_ack_port.read(ack, false) == RTT::NewData && ack >= call_trace_flush_id)
+		{
+			return true;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	// the remaining batches are written without waiting
+	call_trace_flushing = false;
+	RTT::log(RTT::Warning) << "[" << this->getName() << "] The collector did not acknowledge the call trace samples within " << call_trace_flush_timeout << "s." << RTT::endlog();
+	return false;
+}
+
+void RTTIntrospectionBase::awaitFlushedBatch(RTT::base::PortInterface &port)
+{
+	if (call_trace_flushing && !isBufferedConnection(port))
+	{
+		requestCallTraceFlushAck();
+	}
+}
+
+bool RTTIntrospectionBase::isBufferedConnection(RTT::base::PortInterface &port)
+{
+	for (const RTT::internal::ConnectionManager::ChannelDescriptor &descriptor : port.getManager()->getConnections())
+	{
+		if (descriptor.get<2>().type == RTT::ConnPolicy::DATA)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void RTTIntrospectionBase::releaseQueuedCallTraceBlocks()
+{
+	CallTraceBlock **queued = 0;
+	while ((queued = call_trace_blocks_filled.front()) != 0)
+	{
+		(*queued)->release();
+		call_trace_blocks_filled.pop();
+	}
+	if (call_trace_block)
+	{
+		call_trace_block->release();
+		call_trace_block = 0;
+	}
+}
+
+void RTTIntrospectionBase::reclaimCallTraceBlockPool()
+{
+	// the consumer reads the events in place, give it the flush timeout to release the blocks
+	const uint_least64_t release_start = time_service->getNSecs();
+	while (call_trace_block_pool.inUse() > 0 && (time_service->getNSecs() - release_start) * 1E-9 < call_trace_flush_timeout)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	if (call_trace_block_pool.inUse() > 0)
+	{
+		RTT::log(RTT::Warning) << "[" << this->getName() << "] " << call_trace_block_pool.inUse() << " call trace blocks are still held by a consumer, leaking the block pool instead of freeing it." << RTT::endlog();
+		call_trace_block_pool.abandon();
+	}
+}
+
+void RTTIntrospectionBase::appendCallTraceSample(const CallTraceEvent &cte, const uint16_t call_name_id)
+{
+	if (call_trace_storage.empty())
+	{
+		call_trace_storage.push_back(cts_prototype);
+		call_trace_storage.back().call_name = BATCH_SEQUENCE_NAME;
+		call_trace_storage.back().call_time = trace_clock.toNSecs(cte.call_time);
+		call_trace_storage.back().call_duration = ++call_trace_batch_sequence;
+	}
+	if (call_name_id != sampling_factor_name_id)
+	{
+		call_trace_storage_events++;
+	}
+	call_trace_storage.push_back(cts_prototype);
+	rstrt::monitoring::CallTraceSample &cts = call_trace_storage.back();
+	cts.call_name = call_names.getName(call_name_id);
+	// raw timestamps are only converted here, outside of the real-time thread
+	cts.call_time = trace_clock.toNSecs(cte.call_time);
+	if (call_name_id == sampling_factor_name_id)
+	{
+		cts.call_duration = cte.sampling_factor;
+	}
+	else
+	{
+		cts.call_duration = cte.call_duration > 0 ? trace_clock.toNSecs(cte.call_duration) : 0;
+	}
+	cts.call_type = static_cast<rstrt::monitoring::CallTraceSample::CallType>(cte.call_type);
+	if (call_trace_storage.size() >= getCallTraceBatchSize())
+	{
+		// publish if the storage is full.
+		publishCallTraceSamples();
+	}
+}
+
+void RTTIntrospectionBase::publishCallTraceSamples()
+{
+	out_call_trace_sample_vec_port.write(call_trace_storage);
+	awaitFlushedBatch(out_call_trace_sample_vec_port);
+	call_trace_storage.clear();
+	call_trace_events_sent += call_trace_storage_events;
+	call_trace_storage_events = 0;
+	batch_sampling_factor = 0;
+	last_send = time_service->getNSecs();
+}
+
+void RTTIntrospectionBase::appendCallTraceRecord(const CallTraceEvent &cte)
+{
+	if (call_trace_records.empty())
+	{
+		CallTraceRecord marker = CallTraceRecord();
+		marker.call_time = ++call_trace_batch_sequence;
+		marker.component_id = static_cast<uint16_t>(component_id);
+		marker.flags = CallTraceRecord::FLAG_BATCH_SEQUENCE;
+		call_trace_records.push_back(marker);
+	}
+	// the sampling factor is part of every record, no marker needed
+	call_trace_records.push_back(toCallTraceRecord(cte, trace_clock, static_cast<uint16_t>(component_id)));
+	if (call_trace_records.size() >= getCallTraceBatchSize())
+	{
+		publishCallTraceRecords();
+	}
+}
+
+void RTTIntrospectionBase::publishCallTraceRecords()
+{
+	out_call_trace_record_port.write(call_trace_records);
+	awaitFlushedBatch(out_call_trace_record_port);
+	// without the sequence marker
+	call_trace_events_sent += call_trace_records.size() - 1;
+	call_trace_records.clear();
+	last_send = time_service->getNSecs();
+}
+
+void RTTIntrospectionBase::collectUnknownCallNames()
+{
+	std::string *call_name = 0;
+	while ((call_name = unknown_call_name_ring.front()) != 0)
+	{
+		if (unknown_call_names.insert(*call_name).second)
+		{
+			RTT::log(RTT::Warning) << "[" << this->getName() << "] processCTS() was called with the call name \"" << *call_name << "\", which is not registered. It is traced as <unregistered> until the next configureHook, register it with registerCallName() in configureHookInternal()." << RTT::endlog();
+		}
+		unknown_call_name_ring.pop();
+	}
+}
+
+void RTTIntrospectionBase::drainCallTraceBlocks(const bool flush)
+{
+	adoptDrainStorage();
+	collectUnknownCallNames();
+	const uint_least64_t batches_before = call_trace_batch_sequence;
+	bool block_port = out_call_trace_block_port.connected();
+	if (block_port && !isBufferedConnection(out_call_trace_block_port))
+	{
+		if (!call_trace_block_port_unbuffered)
+		{
+			RTT::log(RTT::Warning) << "[" << this->getName() << "] out_call_trace_block_port has a data connection, which would lose block pointers, sending the call traces on the other ports." << RTT::endlog();
+		}
+		block_port = false;
+		call_trace_block_port_unbuffered = true;
+	}
+	else
+	{
+		call_trace_block_port_unbuffered = false;
+	}
+	CallTraceBlock **queued = 0;
+	while ((queued = call_trace_blocks_filled.front()) != 0)
+	{
+		CallTraceBlock *block = *queued;
+		call_trace_blocks_filled.pop();
+		if (call_trace_shm.isOpen())
+		{
+			writeSharedMemoryBlock(*block);
+			block->release();
+			continue;
+		}
+		if (block_port)
+		{
+			// zero-copy: the consumer reads the events in place and releases the block
+			block->sequence = ++call_trace_batch_sequence;
+			block->name_table = call_trace_name_table;
+			if (out_call_trace_block_port.write(block) == RTT::WriteSuccess)
+			{
+				call_trace_events_sent += block->size;
+			}
+			else
+			{
+				// e.g. a full buffer, the consumer sees the missing sequence number
+				block->release();
+			}
+			continue;
+		}
+		if (out_call_trace_record_port.connected())
+		{
+			for (std::size_t i = 0; i < block->size; i++)
+			{
+				appendCallTraceRecord(block->events[i]);
+			}
+			block->release();
+			continue;
+		}
+		for (std::size_t i = 0; i < block->size; i++)
+		{
+			const CallTraceEvent &cte = block->events[i];
+			// every batch starts with the sampling factor and carries a new marker whenever it changes
+			if (cte.sampling_factor != batch_sampling_factor)
+			{
+				CallTraceEvent marker;
+				marker.call_time = cte.call_time;
+				marker.call_duration = 0;
+				marker.call_type = rstrt::monitoring::CallTraceSample::CALL_UNIVERSAL;
+				marker.sampling_factor = cte.sampling_factor;
+				batch_sampling_factor = cte.sampling_factor;
+				appendCallTraceSample(marker, sampling_factor_name_id);
+			}
+			appendCallTraceSample(cte, cte.call_name_id);
+		}
+		block->release();
+	}
+
+	CallTracePerfSample *perf_sample = 0;
+	while ((perf_sample = perf_ring.front()) != 0)
+	{
+		perf_storage.push_back(*perf_sample);
+		perf_storage.back().call_time = trace_clock.toNSecs(perf_sample->call_time);
+		perf_storage.back().call_duration = trace_clock.durationToNSecs(perf_sample->call_duration);
+		perf_ring.pop();
+		if (perf_storage.size() >= getCallTraceBatchSize())
+		{
+			publishPerfSamples();
+		}
+	}
+
+	if (call_trace_summary_active)
+	{
+		publishCallTraceSummary();
+	}
+
+	CallTraceCausalSample *causal_sample = 0;
+	while ((causal_sample = causal_ring.front()) != 0)
+	{
+		causal_storage.push_back(*causal_sample);
+		causal_ring.pop();
+		if (causal_storage.size() >= getCallTraceBatchSize())
+		{
+			publishCausalSamples();
+		}
+	}
+
+	// Send once per (ms) if required.
+	// Otherwise it may happen that the buffer will never get full before the application is shut down
+	// and we do not get any data.
+	// When flushing, the collector acknowledges the data, so everything can be sent.
+	const uint_least64_t send_interval = getCallTraceSendInterval();
+	if (flush || (send_interval > 0 && time_service->getNSecs() - last_send >= send_interval))
+	{
+		if (!call_trace_storage.empty())
+		{
+			publishCallTraceSamples();
+		}
+		if (!call_trace_records.empty())
+		{
+			publishCallTraceRecords();
+		}
+		if (!perf_storage.empty())
+		{
+			publishPerfSamples();
+		}
+		if (!causal_storage.empty())
+		{
+			publishCausalSamples();
+		}
+	}
+	// the flush id is written after this, so the consumer gets the final counters before it is asked to acknowledge
+	if (flush || call_trace_batch_sequence != batches_before)
+	{
+		publishCallTraceAccounting();
+	}
+}
+
+void RTTIntrospectionBase::writeSharedMemoryBlock(const CallTraceBlock &block)
+{
+	CallTraceRecord &marker = call_trace_shm_buffer[0];
+	marker = CallTraceRecord();
+	marker.call_time = ++call_trace_batch_sequence;
+	marker.component_id = static_cast<uint16_t>(component_id);
+	marker.flags = CallTraceRecord::FLAG_BATCH_SEQUENCE;
+	for (std::size_t i = 0; i < block.size; i++)
+	{
+		call_trace_shm_buffer[i + 1] = toCallTraceRecord(block.events[i], trace_clock, static_cast<uint16_t>(component_id));
+	}
+	// what does not fit is counted in the ring, the collector reports it
+	const std::size_t written = call_trace_shm.write(call_trace_shm_buffer.data(), block.size + 1);
+	call_trace_events_sent += written > 0 ? written - 1 : 0;
+}
+
+void RTTIntrospectionBase::publishCallTraceAccounting()
+{
+	const uint_least64_t dropped = call_trace_ring_overflows.load(std::memory_order_relaxed);
+	call_trace_accounting(ACCOUNTING_PRODUCED) = call_trace_events_stored.load(std::memory_order_relaxed) + dropped;
+	call_trace_accounting(ACCOUNTING_DROPPED) = dropped;
+	call_trace_accounting(ACCOUNTING_SENT) = call_trace_events_sent;
+	call_trace_accounting(ACCOUNTING_BATCHES) = call_trace_batch_sequence;
+	out_call_trace_accounting_port.write(call_trace_accounting);
+}
+
+std::size_t RTTIntrospectionBase::getCallTraceBatchSize() const
+{
+	// the tuned size never exceeds the reserved call_trace_storage_size
+	return call_trace_batch_tuner.enabled ? call_trace_batch_tuner.getBatchSize() : call_trace_storage_size;
+}
+
+uint_least64_t RTTIntrospectionBase::getCallTraceSendInterval() const
+{
+	if (call_trace_batch_tuner.enabled)
+	{
+		return trace_clock.durationToNSecs(call_trace_batch_tuner.getMaxAge());
+	}
+	return send_at_least_once_per_Xms * 1000000;
+}
+
+void RTTIntrospectionBase::publishPerfSamples()
+{
+	out_perf_counter_port.write(perf_storage);
+	awaitFlushedBatch(out_perf_counter_port);
+	perf_storage.clear();
+}
+
+void RTTIntrospectionBase::publishCallTraceSummary()
+{
+	call_trace_summary_records.clear();
+	const bool handed_over = call_trace_summary.consume([this](const uint16_t call_name_id, const RTTIntrospectionSummary::Entry &entry, const uint_least64_t start, const uint_least64_t end) {
+		CallTraceSummaryRecord record;
+		record.start_time = trace_clock.toNSecs(start);
+		record.end_time = trace_clock.toNSecs(end);
+		record.calls = entry.calls;
+		record.reads_new_data = entry.reads_new_data;
+		record.reads_old_data = entry.reads_old_data;
+		record.reads_no_data = entry.reads_no_data;
+		record.writes = entry.writes;
+		record.durations = entry.durations;
+		record.duration_sum = trace_clock.durationToNSecs(entry.duration_sum);
+		record.duration_min = trace_clock.durationToNSecs(entry.duration_min);
+		record.duration_max = trace_clock.durationToNSecs(entry.duration_max);
+		record.component_id = static_cast<uint16_t>(component_id);
+		record.call_name_id = call_name_id;
+		record.reserved = 0;
+		call_trace_summary_records.push_back(record);
+	});
+	if (handed_over && !call_trace_summary_records.empty())
+	{
+		out_call_trace_summary_port.write(call_trace_summary_records);
+		awaitFlushedBatch(out_call_trace_summary_port);
+	}
+}
+
+void RTTIntrospectionBase::publishCausalSamples()
+{
+	out_causal_trace_port.write(causal_storage);
+	awaitFlushedBatch(out_causal_trace_port);
+	causal_storage.clear();
+}
+
+void RTTIntrospectionBase::drainCallTraceRing()
+{
+	while (call_trace_drain_running.load())
+	{
+		drainCallTraceBlocks(false);
+
+		if (latency_statistics_period > 0 && ((time_service->getNSecs() - last_latency_statistics_send) * 1E-9 >= latency_statistics_period))
+		{
+			updateLatencyStatistics(latency_statistics);
+			out_latency_statistics_port.write(latency_statistics);
+			overhead_model.toNSecs(trace_clock, overhead_model_ns);
+			out_call_trace_overhead_port.write(overhead_model_ns);
+			// the drops are counted even if nothing is sent
+			publishCallTraceAccounting();
+			last_latency_statistics_send = time_service->getNSecs();
+		}
+
+		std::this_thread::sleep_for(std::chrono::duration<double>(call_trace_drain_period));
 	}
-	call_trace_storage.push_back(cts);
 }
 
 //ORO_CREATE_COMPONENT_LIBRARY()
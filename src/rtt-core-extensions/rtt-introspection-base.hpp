@@ -36,6 +36,8 @@
 #include <Eigen/Dense>
 
 #include <vector>
+#include <map>
+#include <set>
 
 #include <Eigen/Core>
 #include <time.h>
@@ -47,6 +49,29 @@
 
 #include <thread>
 #include <memory>
+#include <atomic>
+#include <mutex>
+
+#include "rtt-introspection-ring.hpp"
+#include "rtt-introspection-trace.hpp"
+#include "rtt-introspection-clock.hpp"
+#include "rtt-introspection-histogram.hpp"
+#include "rtt-introspection-sampler.hpp"
+#include "rtt-introspection-block.hpp"
+#include "rtt-introspection-record.hpp"
+#include "rtt-introspection-overhead.hpp"
+#include "rtt-introspection-dump-writer.hpp"
+#include "rtt-introspection-perf.hpp"
+#include "rtt-introspection-batch.hpp"
+#include "rtt-introspection-accounting.hpp"
+#include "rtt-introspection-mask.hpp"
+#include "rtt-introspection-shm.hpp"
+#include "rtt-introspection-memory.hpp"
+#include "rtt-introspection-trigger.hpp"
+#include "rtt-introspection-causal.hpp"
+#include "rtt-introspection-summary.hpp"
+#include "rtt-introspection-handover.hpp"
+#include "rtt-introspection-setting.hpp"
 
 // RST-RT includes
 #include <rst-rt/monitoring/CallTraceSample.hpp>
@@ -56,11 +81,56 @@
 namespace cogimon
 {
 
+/**
+ * Settings that the operations change while the component may be running. The real-time thread adopts them at the
+ * start of its next hook (see RTTIntrospectionHandover), only the fields flagged in changed are applied.
+ */
+struct RTTIntrospectionSettings
+{
+	enum Field
+	{
+		CALL_TRACE = 1,
+		PORT_TRACE = 2,
+		AUTO_WRITE = 4,
+		MAX_AGE = 8,
+		BLOCK_LIMIT = 16
+	};
+
+	RTTIntrospectionSettings() : changed(0), call_trace(false), port_trace(false), auto_write(false), max_age(0), block_limit(0)
+	{
+	}
+
+	unsigned int changed;
+	bool call_trace;
+	bool port_trace;
+	bool auto_write;
+	// raw trace_clock ticks, 0 for none
+	uint_least64_t max_age;
+	std::size_t block_limit;
+};
+
+/**
+ * Batch storages of the drain thread, allocated by setCallTraceStorageSize() in the caller's thread
+ * and swapped in by the drain thread between two batches.
+ */
+struct RTTIntrospectionDrainStorage
+{
+	RTTIntrospectionDrainStorage() : size(0)
+	{
+	}
+
+	std::size_t size;
+	std::vector<rstrt::monitoring::CallTraceSample> samples;
+	std::vector<CallTraceRecord> records;
+	std::vector<CallTracePerfSample> perf;
+	std::vector<CallTraceCausalSample> causal;
+};
+
 class RTTIntrospectionBase : public RTT::TaskContext
 {
   public:
 	RTTIntrospectionBase(std::string const &name);
-	// virtual ~RTTIntrospectionBase() {};
+	virtual ~RTTIntrospectionBase();
 
 	bool configureHook();
 	bool startHook();
@@ -68,6 +138,12 @@ class RTTIntrospectionBase : public RTT::TaskContext
 	void stopHook();
 	void cleanupHook();
 
+	/**
+	 * Remembers the port and the time of the write for the trigger events, called by the writing thread.
+	 * Components that override it have to call RTTIntrospectionBase::dataOnPortHook(port).
+	 */
+	bool dataOnPortHook(RTT::base::PortInterface *port);
+
 	void setCallTraceStorageSize(const int size);
 
 	void enableAllIntrospection(const bool enable);
@@ -76,338 +152,364 @@ class RTTIntrospectionBase : public RTT::TaskContext
 
 	void enableAutoWriteExecutionInformation(const bool enable);
 
+	// introspection overhead per updateHook in raw trace_clock ticks
 	std::vector<uint_least64_t>
 		executionTimes;
 
+	/**
+	 * Registers a port for tracing and returns a handle with the precomputed sample.
+	 * Call this in configureHookInternal() (or earlier), not while the component is running.
+	 * The handle is then used with readPort/writePort.
+	 */
 	template <class T>
-	RTT::FlowStatus readPort(RTT::InputPort<T> &input_port, RTT::base::DataSourceBase::shared_ptr source, bool copy_old_data = true)
+	PortTraceHandle<RTT::InputPort<T>> registerTracedPort(RTT::InputPort<T> &input_port)
+	{
+		return PortTraceHandle<RTT::InputPort<T>>(&input_port, registerPortName(&input_port), &causal_ports[&input_port]);
+	}
+
+	template <class T>
+	PortTraceHandle<RTT::OutputPort<T>> registerTracedPort(RTT::OutputPort<T> &output_port)
+	{
+		return PortTraceHandle<RTT::OutputPort<T>>(&output_port, registerPortName(&output_port), &causal_ports[&output_port]);
+	}
+
+	template <class T, class SampleT>
+	RTT::FlowStatus readPort(const PortTraceHandle<RTT::InputPort<T>> &handle, SampleT &&sample, bool copy_old_data = true)
 	{
-		RTT::FlowStatus f = input_port.read(source, copy_old_data);
-		if (useCallTraceIntrospection && usePortTraceIntrospection)
+		RTT::FlowStatus f = handle.port->read(sample, copy_old_data);
+		if (useCausalTrace && f == RTT::NewData && handle.causal)
 		{
-			cts_port.call_time = time_service->getNSecs();
-			cts_port.call_name = input_port.getName();
-			if (f == RTT::NoData)
-			{
-				cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_READ_NODATA;
-			}
-			else if (f == RTT::OldData)
-			{
-				cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_READ_OLDDATA;
-			}
-			else if (f == RTT::NewData)
-			{
-				cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_READ_NEWDATA;
-			}
-			// out_call_trace_sample_port.write(cts_port);
-			// if (((cts_port.call_time - cts_last_send) > cts_send_latest_after && !call_trace_storage.empty()) || (call_trace_storage.size() >= call_trace_storage_size)) {
-			if (call_trace_storage.size() >= call_trace_storage_size)
-			{
-				// publish if the time limit has been passed or if the storage is full.
-				out_call_trace_sample_vec_port.write(call_trace_storage);
-				// cts_last_send = cts_port.call_time;
-				call_trace_storage.clear();
-			}
-			call_trace_storage.push_back(cts_port);
+			traceCausalRead(*handle.causal);
+		}
+		if (call_trace_cycle_sampled && useCallTraceIntrospection && usePortTraceIntrospection && trace_mask.isEnabled(handle.cte.call_name_id))
+		{
+			tracePortAccess(handle.cte, flowStatusCallType(f));
 		}
 		return f;
 	}
 
 	template <class T>
-	RTT::FlowStatus readPort(RTT::InputPort<T> &input_port, typename RTT::base::ChannelElement<T>::reference_t sample, bool copy_old_data = true)
+	void writePort(const PortTraceHandle<RTT::OutputPort<T>> &handle, const T &sample)
 	{
-		RTT::FlowStatus f = input_port.read(sample, copy_old_data);
-		if (useCallTraceIntrospection && usePortTraceIntrospection)
+		// before the write, so that a reader that gets the sample also gets its context
+		if (useCausalTrace && handle.causal)
 		{
-			cts_port.call_time = time_service->getNSecs();
-			cts_port.call_name = input_port.getName();
-			if (f == RTT::NoData)
-			{
-				cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_READ_NODATA;
-			}
-			else if (f == RTT::OldData)
-			{
-				cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_READ_OLDDATA;
-			}
-			else if (f == RTT::NewData)
-			{
-				cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_READ_NEWDATA;
-			}
-			// out_call_trace_sample_port.write(cts_port);
-			// if (((cts_port.call_time - cts_last_send) > cts_send_latest_after && !call_trace_storage.empty()) || (call_trace_storage.size() >= call_trace_storage_size)) {
-			if (call_trace_storage.size() >= call_trace_storage_size)
-			{
-				// publish if the time limit has been passed or if the storage is full.
-				out_call_trace_sample_vec_port.write(call_trace_storage);
-				// cts_last_send = cts_port.call_time;
-				call_trace_storage.clear();
-			}
-			call_trace_storage.push_back(cts_port);
+			traceCausalWrite(*handle.causal);
+		}
+		handle.port->write(sample);
+		if (call_trace_cycle_sampled && useCallTraceIntrospection && usePortTraceIntrospection && trace_mask.isEnabled(handle.cte.call_name_id))
+		{
+			tracePortAccess(handle.cte, rstrt::monitoring::CallTraceSample::CALL_PORT_WRITE);
 		}
-		return f;
+	}
+
+	/**
+	 * Overloads for unregistered ports, kept for existing components. This is the slow path: every access looks the
+	 * port up in the ports registered in configureHook (a std::map::find). Use registerTracedPort() in new code.
+	 */
+
+	template <class T>
+	RTT::FlowStatus readPort(RTT::InputPort<T> &input_port, RTT::base::DataSourceBase::shared_ptr source, bool copy_old_data = true)
+	{
+		return readPort(lookupTracedPort(&input_port), source, copy_old_data);
+	}
+
+	template <class T>
+	RTT::FlowStatus readPort(RTT::InputPort<T> &input_port, typename RTT::base::ChannelElement<T>::reference_t sample, bool copy_old_data = true)
+	{
+		return readPort(lookupTracedPort(&input_port), sample, copy_old_data);
 	}
 
 	// with pointer
 	template <class T>
 	RTT::FlowStatus readPort(boost::shared_ptr<RTT::InputPort<T>> input_port, RTT::base::DataSourceBase::shared_ptr source, bool copy_old_data = true)
 	{
-		RTT::FlowStatus f = input_port->read(source, copy_old_data);
-		if (useCallTraceIntrospection && usePortTraceIntrospection)
-		{
-			cts_port.call_time = time_service->getNSecs();
-			cts_port.call_name = input_port->getName();
-			if (f == RTT::NoData)
-			{
-				cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_READ_NODATA;
-			}
-			else if (f == RTT::OldData)
-			{
-				cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_READ_OLDDATA;
-			}
-			else if (f == RTT::NewData)
-			{
-				cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_READ_NEWDATA;
-			}
-			// out_call_trace_sample_port.write(cts_port);
-			// if (((cts_port.call_time - cts_last_send) > cts_send_latest_after && !call_trace_storage.empty()) || (call_trace_storage.size() >= call_trace_storage_size)) {
-			if (call_trace_storage.size() >= call_trace_storage_size)
-			{
-				// publish if the time limit has been passed or if the storage is full.
-				out_call_trace_sample_vec_port.write(call_trace_storage);
-				// cts_last_send = cts_port.call_time;
-				call_trace_storage.clear();
-			}
-			call_trace_storage.push_back(cts_port);
-		}
-		return f;
+		return readPort(lookupTracedPort(input_port.get()), source, copy_old_data);
 	}
 
 	template <class T>
 	RTT::FlowStatus readPort(boost::shared_ptr<RTT::InputPort<T>> input_port, typename RTT::base::ChannelElement<T>::reference_t sample, bool copy_old_data = true)
 	{
-		RTT::FlowStatus f = input_port->read(sample, copy_old_data);
-		if (useCallTraceIntrospection && usePortTraceIntrospection)
-		{
-			cts_port.call_time = time_service->getNSecs();
-			cts_port.call_name = input_port->getName();
-			if (f == RTT::NoData)
-			{
-				cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_READ_NODATA;
-			}
-			else if (f == RTT::OldData)
-			{
-				cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_READ_OLDDATA;
-			}
-			else if (f == RTT::NewData)
-			{
-				cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_READ_NEWDATA;
-			}
-			// out_call_trace_sample_port.write(cts_port);
-			// if (((cts_port.call_time - cts_last_send) > cts_send_latest_after && !call_trace_storage.empty()) || (call_trace_storage.size() >= call_trace_storage_size)) {
-			if (call_trace_storage.size() >= call_trace_storage_size)
-			{
-				// publish if the time limit has been passed or if the storage is full.
-				out_call_trace_sample_vec_port.write(call_trace_storage);
-				// cts_last_send = cts_port.call_time;
-				call_trace_storage.clear();
-			}
-			call_trace_storage.push_back(cts_port);
-		}
-		return f;
+		return readPort(lookupTracedPort(input_port.get()), sample, copy_old_data);
 	}
 
 	template <class T>
 	RTT::FlowStatus readPort(RTT::InputPort<T> *input_port, RTT::base::DataSourceBase::shared_ptr source, bool copy_old_data = true)
 	{
-		RTT::FlowStatus f = input_port->read(source, copy_old_data);
-		if (useCallTraceIntrospection && usePortTraceIntrospection)
-		{
-			cts_port.call_time = time_service->getNSecs();
-			cts_port.call_name = input_port->getName();
-			if (f == RTT::NoData)
-			{
-				cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_READ_NODATA;
-			}
-			else if (f == RTT::OldData)
-			{
-				cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_READ_OLDDATA;
-			}
-			else if (f == RTT::NewData)
-			{
-				cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_READ_NEWDATA;
-			}
-			// out_call_trace_sample_port.write(cts_port);
-			// if (((cts_port.call_time - cts_last_send) > cts_send_latest_after && !call_trace_storage.empty()) || (call_trace_storage.size() >= call_trace_storage_size)) {
-			if (call_trace_storage.size() >= call_trace_storage_size)
-			{
-				// publish if the time limit has been passed or if the storage is full.
-				out_call_trace_sample_vec_port.write(call_trace_storage);
-				// cts_last_send = cts_port.call_time;
-				call_trace_storage.clear();
-			}
-			call_trace_storage.push_back(cts_port);
-		}
-		return f;
+		return readPort(lookupTracedPort(input_port), source, copy_old_data);
 	}
 
 	template <class T>
 	RTT::FlowStatus readPort(RTT::InputPort<T> *input_port, typename RTT::base::ChannelElement<T>::reference_t sample, bool copy_old_data = true)
 	{
-		RTT::FlowStatus f = input_port->read(sample, copy_old_data);
-		if (useCallTraceIntrospection && usePortTraceIntrospection)
-		{
-			cts_port.call_time = time_service->getNSecs();
-			cts_port.call_name = input_port->getName();
-			if (f == RTT::NoData)
-			{
-				cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_READ_NODATA;
-			}
-			else if (f == RTT::OldData)
-			{
-				cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_READ_OLDDATA;
-			}
-			else if (f == RTT::NewData)
-			{
-				cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_READ_NEWDATA;
-			}
-			// out_call_trace_sample_port.write(cts_port);
-			// if (((cts_port.call_time - cts_last_send) > cts_send_latest_after && !call_trace_storage.empty()) || (call_trace_storage.size() >= call_trace_storage_size)) {
-			if (call_trace_storage.size() >= call_trace_storage_size)
-			{
-				// publish if the time limit has been passed or if the storage is full.
-				out_call_trace_sample_vec_port.write(call_trace_storage);
-				// cts_last_send = cts_port.call_time;
-				call_trace_storage.clear();
-			}
-			call_trace_storage.push_back(cts_port);
-		}
-		return f;
+		return readPort(lookupTracedPort(input_port), sample, copy_old_data);
 	}
 
 	template <class T>
 	void writePort(RTT::OutputPort<T> &output_port, const T &sample)
 	{
-		output_port.write(sample);
-		if (useCallTraceIntrospection && usePortTraceIntrospection)
-		{
-			cts_port.call_time = time_service->getNSecs();
-			cts_port.call_name = output_port.getName();
-			cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_WRITE;
-			// out_call_trace_sample_port.write(cts_port);
-			// if (((cts_port.call_time - cts_last_send) > cts_send_latest_after && !call_trace_storage.empty()) || (call_trace_storage.size() >= call_trace_storage_size)) {
-			if (call_trace_storage.size() >= call_trace_storage_size)
-			{
-				// publish if the time limit has been passed or if the storage is full.
-				out_call_trace_sample_vec_port.write(call_trace_storage);
-				// cts_last_send = cts_port.call_time;
-				call_trace_storage.clear();
-			}
-			call_trace_storage.push_back(cts_port);
-		}
+		writePort(lookupTracedPort(&output_port), sample);
 	}
 
 	template <class T>
 	void writePort(boost::shared_ptr<RTT::OutputPort<T>> output_port, const T &sample)
 	{
-		output_port->write(sample);
-		if (useCallTraceIntrospection && usePortTraceIntrospection)
-		{
-			cts_port.call_time = time_service->getNSecs();
-			cts_port.call_name = output_port->getName();
-			cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_WRITE;
-			// out_call_trace_sample_port.write(cts_port);
-			// if (((cts_port.call_time - cts_last_send) > cts_send_latest_after && !call_trace_storage.empty()) || (call_trace_storage.size() >= call_trace_storage_size)) {
-			if (call_trace_storage.size() >= call_trace_storage_size)
-			{
-				// publish if the time limit has been passed or if the storage is full.
-				out_call_trace_sample_vec_port.write(call_trace_storage);
-				// cts_last_send = cts_port.call_time;
-				call_trace_storage.clear();
-			}
-			call_trace_storage.push_back(cts_port);
-		}
+		writePort(lookupTracedPort(output_port.get()), sample);
 	}
 
 	template <class T>
 	void writePort(std::shared_ptr<RTT::OutputPort<T>> output_port, const T &sample)
 	{
-		output_port->write(sample);
-		if (useCallTraceIntrospection && usePortTraceIntrospection)
-		{
-			cts_port.call_time = time_service->getNSecs();
-			cts_port.call_name = output_port->getName();
-			cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_WRITE;
-			// out_call_trace_sample_port.write(cts_port);
-			// if (((cts_port.call_time - cts_last_send) > cts_send_latest_after && !call_trace_storage.empty()) || (call_trace_storage.size() >= call_trace_storage_size)) {
-			if (call_trace_storage.size() >= call_trace_storage_size)
-			{
-				// publish if the time limit has been passed or if the storage is full.
-				out_call_trace_sample_vec_port.write(call_trace_storage);
-				// cts_last_send = cts_port.call_time;
-				call_trace_storage.clear();
-			}
-			call_trace_storage.push_back(cts_port);
-		}
+		writePort(lookupTracedPort(output_port.get()), sample);
 	}
 
 	template <class T>
 	void writePort(RTT::OutputPort<T> *output_port, const T &sample)
 	{
-		output_port->write(sample);
-		if (useCallTraceIntrospection && usePortTraceIntrospection)
-		{
-			cts_port.call_time = time_service->getNSecs();
-			cts_port.call_name = output_port->getName();
-			cts_port.call_type = rstrt::monitoring::CallTraceSample::CALL_PORT_WRITE;
-			// out_call_trace_sample_port.write(cts_port);
-			// if (((cts_port.call_time - cts_last_send) > cts_send_latest_after && !call_trace_storage.empty()) || (call_trace_storage.size() >= call_trace_storage_size)) {
-			if (call_trace_storage.size() >= call_trace_storage_size)
-			{
-				// publish if the time limit has been passed or if the storage is full.
-				out_call_trace_sample_vec_port.write(call_trace_storage);
-				// cts_last_send = cts_port.call_time;
-				call_trace_storage.clear();
-			}
-			call_trace_storage.push_back(cts_port);
-		}
+		writePort(lookupTracedPort(output_port), sample);
 	}
 
 	uint_least64_t getWMECT();
 	void setWMECT(const uint_least64_t wmect);
 
+	uint_least64_t getUpdateHookLatencyPercentile(const double percentile);
+	uint_least64_t getIntrospectionOverheadPercentile(const double percentile);
+	uint_least64_t getPeriodJitterPercentile(const double percentile);
+	uint_least64_t getTriggerLatencyPercentile(const double percentile);
+	uint_least64_t getDeadlineMisses();
+	uint_least64_t getCpuMigrations();
+	uint_least64_t getCpuOffAffinity();
+	void printLatencyStatistics();
+
 	RTT::os::TimeService *time_service;
+	// timestamps of the call trace events, raw values are converted by the drain thread
+	RTTIntrospectionClock trace_clock;
 
+	/**
+	 * String based variant of the trace scopes, kept for existing components. The call name has to be registered with
+	 * registerCallName() before or within configureHookInternal() (while configuring, processCTS() registers it itself).
+	 * While running, an unknown name is traced as "<unregistered>", logged once by the drain side and registered in
+	 * the next configureHook.
+	 */
 	void processCTS(rstrt::monitoring::CallTraceSample &cts);
 
+	/**
+	 * Registers an additional call name for processCTS and returns its id.
+	 * Only call this before or within configureHookInternal().
+	 */
+	uint16_t registerCallName(const std::string &call_name);
+
+	/**
+	 * Marks begin and end of a named sub-phase (id from registerCallName()).
+	 * Stored as one CALL_START_WITH_DURATION sample with the nesting depth when the scope ends.
+	 * Real-time safe. Prefer traceScope(), which can not miss the end.
+	 */
+	inline void beginTraceScope(const uint16_t call_name_id)
+	{
+		if (trace_scope_depth < MAX_TRACE_SCOPE_DEPTH)
+		{
+			CallTraceEvent &cte = trace_scope_stack[trace_scope_depth];
+			cte.call_name_id = call_name_id;
+			// 0 marks a scope that is not traced
+			cte.call_time = useCallTraceIntrospection && call_trace_cycle_sampled && trace_mask.isEnabled(call_name_id) ? trace_clock.now() : 0;
+		}
+		trace_scope_depth++;
+	}
+
+	inline void endTraceScope()
+	{
+		if (trace_scope_depth == 0)
+		{
+			return;
+		}
+		trace_scope_depth--;
+		if (trace_scope_depth < MAX_TRACE_SCOPE_DEPTH && trace_scope_stack[trace_scope_depth].call_time > 0)
+		{
+			CallTraceEvent &cte = trace_scope_stack[trace_scope_depth];
+			cte.call_duration = trace_clock.now();
+			cte.sampling_factor = call_trace_cycle_factor;
+			storeCallTraceEvent(cte);
+		}
+	}
+
+	TraceScope<RTTIntrospectionBase> traceScope(const uint16_t call_name_id)
+	{
+		return TraceScope<RTTIntrospectionBase>(*this, call_name_id);
+	}
+
 	//protected:
 	bool useCallTraceIntrospection;
 	bool usePortTraceIntrospection;
+	bool useTSCClock;
+	/**
+	 * Per-cycle counter deltas of updateHookInternal() on out_perf_counter_port (costs two system calls per sampled cycle).
+	 * The counters are opened in the first sampled cycle, because they count the calling thread: that cycle pays
+	 * once for up to 12 perf_event_open calls (two rounds of six when the kernel may not be counted).
+	 */
+	bool usePerfCounters;
+	// the drain thread writes the records into a shared memory ring for rtt-introspection-collector instead of the ports
+	bool useSharedMemoryTrace;
+	// prefault and mlock all introspection buffers in configureHook
+	bool useMemoryLock;
+	// trace which event port triggered updateHook and the wakeup latency (event-driven activities only)
+	bool useTriggerIntrospection;
+	// propagate a sequence id and origin time from the read to the written samples, see CallTraceCausalSample
+	bool useCausalTrace;
+	// sched_getcpu() around updateHookInternal(), sent with the perf samples
+	bool useCpuTrace;
+
+	// bytes of introspection memory that are locked
+	uint_least64_t getLockedIntrospectionMemory();
 
+	/**
+	 * sendAtLeastOncePerXms(), setCallTraceStorageSize(), enableAllIntrospection() and enableAutoWriteExecutionInformation()
+	 * may be called while the component is running, the change is picked up at the next cycle (the storage at the next
+	 * batch). So may the properties useCallTraceIntrospection, usePortTraceIntrospection and call_trace_storage_size,
+	 * the other properties are only meant to be set before configureHook.
+	 */
 	void sendAtLeastOncePerXms(const uint_least64_t Xms);
 
+	/**
+	 * Enables or disables the tracing of all ports, hooks and TraceScopes whose name matches the shell pattern (e.g. "robot_*").
+	 * Can be called while running, the real-time thread picks the change up at the start of the next updateHook.
+	 * Returns the number of matching names. Not real-time safe.
+	 */
+	unsigned int setTraceEnabled(const std::string &pattern, const bool enable);
+	std::vector<std::string> getTraceEnabledNames();
+
   private:
 	RTT::OutputPort<rstrt::monitoring::CallTraceSample> out_call_trace_sample_port;
 
 	RTT::OutputPort<std::vector<rstrt::monitoring::CallTraceSample>> out_call_trace_sample_vec_port;
 
-	rstrt::monitoring::CallTraceSample cts_start;
-	rstrt::monitoring::CallTraceSample cts_configure;
-	rstrt::monitoring::CallTraceSample cts_update;
-	rstrt::monitoring::CallTraceSample cts_stop;
-	rstrt::monitoring::CallTraceSample cts_cleanup;
+	/**
+	 * Hands over the filled CallTraceBlocks by pointer, the consumer has to release() them.
+	 * Connect it with a buffer of at least RTTIntrospectionBlockPool::MAX_BLOCKS, a block that does not fit is released
+	 * again and shows up as a missing batch. A data connection would overwrite the pointers, so as long as there is one
+	 * (or nothing is connected), the drain thread falls back to out_call_trace_record_port or out_call_trace_sample_vec_port.
+	 * The events stay in call_trace_block_pool, see reclaimCallTraceBlockPool().
+	 */
+	RTT::OutputPort<CallTraceBlock *> out_call_trace_block_port;
+	// warns once per data connection on out_call_trace_block_port
+	bool call_trace_block_port_unbuffered;
+
+	// compact batches of CallTraceRecord, used instead of out_call_trace_sample_vec_port if connected
+	RTT::OutputPort<std::vector<CallTraceRecord>> out_call_trace_record_port;
+
+	/**
+	 * Flush handshake: after the remaining samples are written in flushCallTraces(), a new flush id is written to
+	 * out_call_trace_flush_port and the consumer echoes it on in_call_trace_flush_ack_port once it has read them.
+	 * A data connection only keeps the last batch, so on such a connection each batch of the flush is acknowledged
+	 * before the next one is written (see awaitFlushedBatch()).
+	 */
+	RTT::OutputPort<uint_least64_t> out_call_trace_flush_port;
+	RTT::InputPort<uint_least64_t> in_call_trace_flush_ack_port;
+	uint_least64_t call_trace_flush_id;
+	// seconds to wait for the acknowledgements, and for the collector of the shared memory ring
+	double call_trace_flush_timeout;
+	// while flushCallTraces() runs with a connected handshake, until an acknowledgement times out
+	bool call_trace_flushing;
+	// time service ns, shared by all acknowledgements of one flush
+	uint_least64_t call_trace_flush_deadline;
+	// writes a new flush id and waits for it until call_trace_flush_deadline
+	bool requestCallTraceFlushAck();
+	// called after each batch written by the drain side, waits for the acknowledgement if the port is not buffered
+	void awaitFlushedBatch(RTT::base::PortInterface &port);
+	static bool isBufferedConnection(RTT::base::PortInterface &port);
+
+	// publishes the id to name mapping of the call trace events once per configureHook
+	RTT::OutputPort<std::vector<std::string>> out_call_name_table_port;
+
+	CallTraceEvent cte_start;
+	CallTraceEvent cte_configure;
+	CallTraceEvent cte_update;
+	CallTraceEvent cte_stop;
+	CallTraceEvent cte_cleanup;
+	CallTraceEvent cte_deadline_miss;
+
+	// container name set, used by the drain thread to create the samples
+	rstrt::monitoring::CallTraceSample cts_prototype;
+
+	RTTIntrospectionNameRegistry call_names;
+	// copy of call_names for the consumers of out_call_trace_block_port, created in configureHook
+	std::shared_ptr<const CallTraceNameTable> call_trace_name_table;
+	// from configureHook until the name table is published, processCTS() may register names
+	bool call_names_open;
+	// names processCTS() did not know while running, from the real-time thread to the drain side
+	RTTIntrospectionRing<std::string> unknown_call_name_ring;
+	// drain side, logged once and registered in the next configureHook
+	std::set<std::string> unknown_call_names;
+	void collectUnknownCallNames();
+	// longer unknown names are not reported, so that the ring never allocates
+	static const std::size_t UNKNOWN_CALL_NAME_LENGTH = 128;
+	std::map<const RTT::base::PortInterface *, uint16_t> port_name_ids;
+	// process-wide unique id of this component
+	unsigned int component_id;
+
+	// per call name id, see setTraceEnabled()
+	RTTIntrospectionTraceMask trace_mask;
+	// comma separated patterns applied in configureHook in this order, a leading '-' disables, e.g. "-*,robot_*,updateHook()"
+	std::string call_trace_selection;
+	void applyTraceSelection(const std::string &selection);
 
-	rstrt::monitoring::CallTraceSample cts_port;
+	/**
+	 * Does not allocate, but costs a std::map::find per call. Ports that were added after configureHookInternal()
+	 * are reported as unregistered.
+	 */
+	template <class PortT>
+	inline PortTraceHandle<PortT> lookupTracedPort(PortT *port) const
+	{
+		const RTTIntrospectionCausalPort *causal = 0;
+		if (useCausalTrace)
+		{
+			std::map<const RTT::base::PortInterface *, RTTIntrospectionCausalPort>::const_iterator causal_it = causal_ports.find(port);
+			causal = causal_it != causal_ports.end() ? &causal_it->second : 0;
+		}
+		std::map<const RTT::base::PortInterface *, uint16_t>::const_iterator it = port_name_ids.find(port);
+		if (it != port_name_ids.end())
+		{
+			return PortTraceHandle<PortT>(port, it->second, causal);
+		}
+		return PortTraceHandle<PortT>(port, RTTIntrospectionNameRegistry::UNREGISTERED_ID, causal);
+	}
+
+	uint16_t registerPortName(const RTT::base::PortInterface *port);
+	void registerPortNames(RTT::Service::shared_ptr service);
+
+	static inline uint8_t flowStatusCallType(const RTT::FlowStatus f)
+	{
+		switch (f)
+		{
+		case RTT::NewData:
+			return rstrt::monitoring::CallTraceSample::CALL_PORT_READ_NEWDATA;
+		case RTT::OldData:
+			return rstrt::monitoring::CallTraceSample::CALL_PORT_READ_OLDDATA;
+		default:
+			return rstrt::monitoring::CallTraceSample::CALL_PORT_READ_NODATA;
+		}
+	}
+
+	/**
+	 * The single place where port accesses are traced.
+	 */
+	inline void tracePortAccess(const CallTraceEvent &handle_cte, const uint8_t call_type)
+	{
+		CallTraceEvent cte = handle_cte;
+		cte.call_time = trace_clock.now();
+		cte.call_type = call_type;
+		cte.sampling_factor = call_trace_cycle_factor;
+		storeCallTraceEvent(cte);
+	}
 
 	uint_least64_t cts_send_latest_after;
 	uint_least64_t cts_last_send;
 
 	/**
 	 * Sending once per (ms) if required.
-	 * Otherwise it may happen that the buffer will never get full before the application is shut down and we do not get any data.
-	 * We also cannot wait until a component is stopped to send the collected data,
-	 * because we do not know at that time whether or not the collector component is stopped or still running to receive the data samples.
+	 * Otherwise a slowly filling batch is only sent when the component is stopped (see flushCallTraces()).
 	*/
-	uint_least64_t send_at_least_once_per_Xms;
+	// read by the drain thread
+	std::atomic<uint_least64_t> send_at_least_once_per_Xms;
 	uint_least64_t last_send;
 
 	virtual bool configureHookInternal() = 0;
@@ -416,16 +518,397 @@ class RTTIntrospectionBase : public RTT::TaskContext
 	virtual void stopHookInternal() = 0;
 	virtual void cleanupHookInternal() = 0;
 
+	/**
+	 * Writes an event into the current block of the pool. This is the only copy of the event on its way to the consumer.
+	 * If all blocks are in use, the event is dropped instead of blocking or allocating.
+	 */
+	inline void storeCallTraceEvent(const CallTraceEvent &cte)
+	{
+		if (!trace_mask.isEnabled(cte.call_name_id))
+		{
+			return;
+		}
+		if (call_trace_summary_active)
+		{
+			call_trace_summary.add(cte);
+			return;
+		}
+		if (!call_trace_block)
+		{
+			call_trace_block = call_trace_block_pool.acquire();
+			if (!call_trace_block)
+			{
+				addCallTraceCount(call_trace_ring_overflows, 1);
+				return;
+			}
+			call_trace_block_start = cte.call_time;
+			call_trace_block_start_cycle = call_trace_cycles;
+			if (call_trace_block->release_latency > 0)
+			{
+				call_trace_batch_tuner.observeDrainLatency(call_trace_block->release_latency);
+				call_trace_block->release_latency = 0;
+			}
+		}
+		call_trace_block->events[call_trace_block->size++] = cte;
+		addCallTraceCount(call_trace_events_stored, 1);
+		if (call_trace_block->size >= call_trace_block_limit)
+		{
+			publishCallTraceBlock();
+		}
+	}
+
+	/**
+	 * Real-time safe: queues the current block for the drain thread.
+	 */
+	inline void publishCallTraceBlock()
+	{
+		if (!call_trace_batch_tuner.enabled)
+		{
+			call_trace_block->state.store(CallTraceBlock::BLOCK_IN_FLIGHT, std::memory_order_relaxed);
+			if (!call_trace_blocks_filled.push(call_trace_block))
+			{
+				addCallTraceCount(call_trace_ring_overflows, call_trace_block->size);
+				call_trace_block->release();
+			}
+			call_trace_block = 0;
+			return;
+		}
+		// the two timestamps are amortized over the batch
+		const uint_least64_t publish_start = trace_clock.now();
+		const std::size_t events = call_trace_block->size;
+		call_trace_block->publish_time = publish_start;
+		call_trace_block->state.store(CallTraceBlock::BLOCK_IN_FLIGHT, std::memory_order_relaxed);
+		if (!call_trace_blocks_filled.push(call_trace_block))
+		{
+			addCallTraceCount(call_trace_ring_overflows, call_trace_block->size);
+			call_trace_block->release();
+		}
+		call_trace_block = 0;
+		overhead_model.updateFlush(trace_clock.now() - publish_start);
+
+		call_trace_batch_tuner.update(events, call_trace_cycles - call_trace_block_start_cycle, publish_start - call_trace_block_start, overhead_model.getFlush());
+		call_trace_block_limit = call_trace_batch_tuner.getBatchSize();
+		call_trace_block_max_age = call_trace_batch_tuner.getMaxAge();
+		overhead_model.setEventsPerFlush(call_trace_block_limit);
+	}
+
+	/**
+	 * Returns the current and the queued blocks to the pool. Only call this while the drain thread is stopped.
+	 */
+	void releaseQueuedCallTraceBlocks();
+	/**
+	 * Not real-time safe. Waits up to call_trace_flush_timeout for the consumer to release the blocks it still holds,
+	 * then abandons the pool (leaking the held blocks instead of freeing them under the consumer), so that it can be
+	 * reallocated. Only call this while the drain thread is stopped.
+	 */
+	void reclaimCallTraceBlockPool();
+
+	/**
+	 * Non real-time side: passes the filled blocks on to out_call_trace_block_port
+	 * or, if nobody is connected to it, resolves them into the call_trace_storage
+	 * and publishes the storage if it is full or if send_at_least_once_per_Xms has passed.
+	 */
+	void drainCallTraceRing();
+	/**
+	 * One pass over the filled blocks. With flush the partially filled batches are published as well.
+	 * Must only be called by the drain thread or while it is stopped.
+	 */
+	void drainCallTraceBlocks(const bool flush);
+	/**
+	 * Not real-time safe: stops the drain thread, publishes everything that was traced so far
+	 * and waits until the consumer acknowledges it. Blocks up to twice call_trace_flush_timeout:
+	 * once for the collector of the shared memory ring and once for all acknowledgements on the ports.
+	 */
+	void flushCallTraces();
+	void startCallTraceDrain();
+	void stopCallTraceDrain();
+	/**
+	 * Starts the drain thread if call traces or causal hops are produced or latency statistics are published,
+	 * otherwise stops it. Not real-time safe,
+	 * called by startHook and by the operations that toggle the tracing, not by the real-time thread that adopts the toggle.
+	 * Blocks that are still queued when it is stopped are sent with the next start or by flushCallTraces().
+	 */
+	void updateCallTraceDrain(const bool call_trace);
+
+	RTTIntrospectionBlockPool call_trace_block_pool;
+	// filled blocks, from the real-time thread to the drain thread
+	RTTIntrospectionRing<CallTraceBlock *> call_trace_blocks_filled;
+	// block the real-time thread is currently writing to, 0 if none is acquired
+	CallTraceBlock *call_trace_block;
+	// raw timestamp of the first event in call_trace_block
+	uint_least64_t call_trace_block_start;
+	// send_at_least_once_per_Xms in raw trace_clock ticks, or tuned by call_trace_batch_tuner
+	uint_least64_t call_trace_block_max_age;
+	// number of events after which a block is published, at most the preallocated block size
+	std::size_t call_trace_block_limit;
+	// events per block of the pool, fixed until the next configureHook
+	std::size_t call_trace_block_capacity;
+
+	/**
+	 * Runtime reconfiguration: the operations prepare the settings and the storages outside of the real-time
+	 * and the drain thread, which adopt them at their cycle boundary and retire the replaced ones.
+	 */
+	RTTIntrospectionHandover<RTTIntrospectionSettings> settings_handover;
+	RTTIntrospectionHandover<RTTIntrospectionDrainStorage> storage_handover;
+	// real-time thread, at the start of each hook
+	inline void adoptIntrospectionSettings()
+	{
+		RTTIntrospectionSettings *settings = settings_handover.take();
+		if (settings)
+		{
+			applyIntrospectionSettings(*settings);
+			settings_handover.retire(settings);
+		}
+	}
+	void applyIntrospectionSettings(const RTTIntrospectionSettings &settings);
+	// drain thread (or while it is stopped), sends the batches collected so far with the old size
+	void adoptDrainStorage();
+	// traced updateHook calls, and their number when call_trace_block was acquired
+	uint_least64_t call_trace_cycles;
+	uint_least64_t call_trace_block_start_cycle;
+	/**
+	 * Auto mode (call_trace_auto_batch): tunes call_trace_block_limit and call_trace_block_max_age in publishCallTraceBlock(),
+	 * replacing call_trace_storage_size and sendAtLeastOncePerXms. The drain thread follows with its batches.
+	 */
+	RTTIntrospectionBatchTuner call_trace_batch_tuner;
+	/**
+	 * Summary mode (call_trace_summary_mode): storeCallTraceEvent() only counts the events per call name and the drain
+	 * thread sends one CallTraceSummaryRecord per name and call_trace_summary_period on out_call_trace_summary_port.
+	 * The raw events are not sent at all.
+	 */
+	bool call_trace_summary_mode;
+	// seconds
+	double call_trace_summary_period;
+	// call_trace_summary_mode as applied in configureHook
+	bool call_trace_summary_active;
+	RTTIntrospectionSummary call_trace_summary;
+	std::vector<CallTraceSummaryRecord> call_trace_summary_records;
+	RTT::OutputPort<std::vector<CallTraceSummaryRecord>> out_call_trace_summary_port;
+	// drain thread (or flushCallTraces)
+	void publishCallTraceSummary();
+	// batch size and send interval (ns, 0 for none) of the drain thread
+	std::size_t getCallTraceBatchSize() const;
+	uint_least64_t getCallTraceSendInterval() const;
+	// number of events that are buffered at most (rounded up to whole blocks of call_trace_storage_size)
+	std::size_t call_trace_ring_size;
+	// written by the real-time thread, read by the drain thread for out_call_trace_accounting_port
+	std::atomic<uint_least64_t> call_trace_ring_overflows;
+	std::atomic<uint_least64_t> call_trace_events_stored;
+
+	// decides at the start of each updateHook whether the events of that cycle are stored
+	RTTIntrospectionSampler call_trace_sampler;
+	bool call_trace_cycle_sampled;
+	uint32_t call_trace_cycle_factor;
+	// open TraceScopes, deeper scopes are counted but not traced
+	static const unsigned int MAX_TRACE_SCOPE_DEPTH = 16;
+	CallTraceEvent trace_scope_stack[MAX_TRACE_SCOPE_DEPTH];
+	unsigned int trace_scope_depth;
+
+	// name id of the marker sample that carries the sampling factor in the vector port batches
+	uint16_t sampling_factor_name_id;
+
+	/**
+	 * Drain thread: appends a sample to the call_trace_storage and publishes the storage if it is full.
+	 */
+	void appendCallTraceSample(const CallTraceEvent &cte, const uint16_t call_name_id);
+	void publishCallTraceSamples();
+	// events (without markers) in call_trace_storage
+	uint_least64_t call_trace_storage_events;
+	// sampling factor of the current batch, 0 if the batch does not have a marker yet
+	uint32_t batch_sampling_factor;
+
+	/**
+	 * Drain thread: appends a record to the call_trace_records and publishes them if they are full.
+	 */
+	void appendCallTraceRecord(const CallTraceEvent &cte);
+	void publishCallTraceRecords();
+
+	/**
+	 * Drain thread: loss accounting, see CallTraceAccountingIndex.
+	 */
+	void publishCallTraceAccounting();
+
+	/**
+	 * Drain thread: writes the block as records (behind a FLAG_BATCH_SEQUENCE record) into call_trace_shm.
+	 */
+	void writeSharedMemoryBlock(const CallTraceBlock &block);
+	/**
+	 * Prefaults and locks the buffers the real-time thread and the drain thread use. Called at the end of configureHook,
+	 * after everything is allocated.
+	 */
+	void lockIntrospectionMemory();
+	RTTIntrospectionMemoryLock introspection_memory;
+
+	// see CallTraceShmHeader, (re)created in configureHook, removed in cleanupHook
+	RTTIntrospectionShmRing call_trace_shm;
+	// records, rounded up to a power of two
+	std::size_t call_trace_shm_size;
+	std::vector<CallTraceRecord> call_trace_shm_buffer;
+	RTT::OutputPort<Eigen::VectorXd> out_call_trace_accounting_port;
+	Eigen::VectorXd call_trace_accounting;
+	// sequence number of the last batch and events sent so far, only accessed by the drain thread
+	uint_least64_t call_trace_batch_sequence;
+	uint_least64_t call_trace_events_sent;
+
+	// thread that drains the ring, so that the real-time thread never writes the (copied) vector to the port.
+	std::thread call_trace_drain_thread;
+	std::atomic<bool> call_trace_drain_running;
+	// from startHook to stopHook, startCallTraceDrain() does nothing otherwise
+	std::atomic<bool> call_trace_drain_enabled;
+	// startHook, stopHook and the operations may start and stop the thread concurrently
+	std::mutex call_trace_drain_mutex;
+	// period in seconds in which the drain thread checks the ring
+	double call_trace_drain_period;
+
+	// only accessed by the drain thread while it is running
 	std::vector<rstrt::monitoring::CallTraceSample> call_trace_storage;
+	std::vector<CallTraceRecord> call_trace_records;
 	std::size_t call_trace_storage_size;
 
 	bool cts_send_pro_hook;
-	// debug information
+	// debug information (in raw trace_clock ticks)
 	uint_least64_t wmect;
 	uint_least64_t wmectI;
 
 	// use this to (de)activate writing of execution time information files.
 	bool auto_write_execution_information;
+	// writes the executionTimes files in the background
+	RTTIntrospectionDumpWriter debug_information_writer;
+
+	// durations of updateHookInternal() and of the introspection overhead per updateHook() in raw trace_clock ticks
+	RTTIntrospectionHistogram update_hook_histogram;
+	RTTIntrospectionHistogram overhead_histogram;
+
+	/**
+	 * Converts the histograms into the layout of out_latency_statistics_port. Not real-time safe.
+	 */
+	void updateLatencyStatistics(Eigen::VectorXd &statistics);
+	// p50, p99, p99.9, max and count of the three histograms, then the deadline misses
+	static const unsigned int LATENCY_STATISTICS_SIZE = 16;
+
+	RTT::OutputPort<Eigen::VectorXd> out_latency_statistics_port;
+
+	/**
+	 * Measures the cost of a timestamp, of storing an event and of publishing a block with the real code paths.
+	 * Only call this in configureHook, it uses and afterwards clears the block pool.
+	 */
+	void calibrateTracingOverhead();
+
+	RTTIntrospectionOverheadModel overhead_model;
+	// the live store cost is only measured every OVERHEAD_UPDATE_INTERVAL cycles, because the measurement costs two timestamps
+	static const unsigned int OVERHEAD_UPDATE_INTERVAL = 64;
+	unsigned int overhead_update_counter;
+	RTT::OutputPort<Eigen::VectorXd> out_call_trace_overhead_port;
+	Eigen::VectorXd overhead_model_ns;
+	Eigen::VectorXd latency_statistics;
+	double latency_statistics_period;
+	uint_least64_t last_latency_statistics_send;
+
+	/**
+	 * Counters around updateHookInternal(). Opened in the first traced updateHook(), because they count the calling thread.
+	 */
+	RTTIntrospectionPerfCounters perf_counters;
+	bool perf_counters_opened;
+	// in stopHook, logs if no counters were available, which is not done in updateHook
+	void closePerfCounters();
+	uint64_t perf_counters_start[PERF_COUNTER_COUNT];
+	// from the real-time thread to the drain thread, call_time is still raw
+	RTTIntrospectionRing<CallTracePerfSample> perf_ring;
+	std::vector<CallTracePerfSample> perf_storage;
+	RTT::OutputPort<std::vector<CallTracePerfSample>> out_perf_counter_port;
+	void publishPerfSamples();
+
+	/**
+	 * Reads the period of the activity. Called in startHook, since the activity may change while the component is stopped.
+	 */
+	void resetPeriodMonitoring();
+
+	// in raw trace_clock ticks, 0 for non-periodic activities
+	uint_least64_t activity_period;
+	uint_least64_t last_update_start;
+
+	/**
+	 * Slot per input port of the component (not of the introspection service, see dataOnPortHook), armed from startHook
+	 * to stopHook for non-periodic activities.
+	 * Each activation stores one "trigger(<port>)" event per port that was written since the last one, from the
+	 * first write (call_time) to the start of updateHook (call_duration).
+	 */
+	RTTIntrospectionTriggerTable trigger_table;
+	void registerTriggerPorts(RTT::Service::shared_ptr service, std::vector<std::pair<const void *, uint16_t>> &entries);
+	// write to updateHook in raw trace_clock ticks
+	RTTIntrospectionHistogram trigger_latency_histogram;
+
+	/**
+	 * Causal tracing: the ports are registered in RTTIntrospectionCausalRegistry in configureHook, the input ports find
+	 * the output port they are connected to in startHook. A read with new data records a hop sample and makes the
+	 * context with the oldest origin the context of the cycle, the writes of the cycle pass it on.
+	 * Writes in a cycle without such a read start a new chain.
+	 * The slot of an output port only holds the context of its last sample, so only data connections are followed:
+	 * the reader of a buffer may get an older sample than the one the slot describes.
+	 */
+	void registerCausalPorts(RTT::Service::shared_ptr service);
+	void unregisterCausalPorts();
+	void resolveCausalUpstream(RTT::Service::shared_ptr service);
+	void traceCausalRead(const RTTIntrospectionCausalPort &causal_port);
+	void traceCausalWrite(const RTTIntrospectionCausalPort &causal_port);
+	// the entries are only reset, never erased, the handles of registerTracedPort() point to them
+	std::map<const RTT::base::PortInterface *, RTTIntrospectionCausalPort> causal_ports;
+	// reset at the start of each updateHook
+	CausalContext causal_context;
+	// from the real-time thread to the drain thread
+	RTTIntrospectionRing<CallTraceCausalSample> causal_ring;
+	std::vector<CallTraceCausalSample> causal_storage;
+	RTT::OutputPort<std::vector<CallTraceCausalSample>> out_causal_trace_port;
+	void publishCausalSamples();
+	RTTIntrospectionHistogram period_jitter_histogram;
+	// written by the real-time thread only, read by the operations
+	std::atomic<uint_least64_t> deadline_misses;
+
+	/**
+	 * Real-time thread, with or without the call traces: start-to-start period jitter and overruns of updateHook,
+	 * only meaningful for periodic activities. countDeadlineMiss returns true for an overrun.
+	 */
+	inline void recordPeriodJitter(const uint_least64_t update_start)
+	{
+		if (activity_period > 0 && last_update_start > 0)
+		{
+			const uint_least64_t actual_period = update_start - last_update_start;
+			period_jitter_histogram.record(actual_period > activity_period ? actual_period - activity_period : activity_period - actual_period);
+		}
+		last_update_start = update_start;
+	}
+
+	inline bool countDeadlineMiss(const uint_least64_t duration)
+	{
+		if (activity_period == 0 || duration <= activity_period)
+		{
+			return false;
+		}
+		// single writer, so no read-modify-write instruction needed
+		deadline_misses.store(deadline_misses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// real-time thread, see useCpuTrace. The affinity is read in startHook.
+	void countCpuMigrations(const int cpu_start, const int cpu_end);
+	// written by the real-time thread only, read by the operations
+	std::atomic<int> last_cpu;
+	unsigned int cpu_affinity;
+	std::atomic<uint_least64_t> cpu_migrations;
+	std::atomic<uint_least64_t> cpu_off_affinity;
+
+	/**
+	 * The properties of the settings that the real-time thread reads, assignments go through settings_handover
+	 * (or setCallTraceStorageSize()) like the operations, so they can be changed while the component is running.
+	 */
+	RTTIntrospectionSettingDataSource<bool>::shared_ptr call_trace_setting;
+	RTTIntrospectionSettingDataSource<bool>::shared_ptr port_trace_setting;
+	RTTIntrospectionSettingDataSource<std::size_t>::shared_ptr storage_size_setting;
+	RTT::Property<bool> call_trace_property;
+	RTT::Property<bool> port_trace_property;
+	RTT::Property<std::size_t> storage_size_property;
+	void requestCallTrace(const bool enable);
+	void requestPortTrace(const bool enable);
 };
 
 } // namespace cogimon
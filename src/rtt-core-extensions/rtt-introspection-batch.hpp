@@ -0,0 +1,184 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_BATCH_HPP
+#define RTT_INTROSPECTION_BATCH_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+
+namespace cogimon
+{
+
+/**
+ * Chooses the number of events per CallTraceBlock and the maximum age of a partially filled block at runtime.
+ * All times are in raw ticks of the trace clock.
+ *
+ * The batch is made as large as needed to keep the flush cost per updateHook below flush_budget
+ * and to keep the blocks in flight (events that wait for the consumer) within half of the pool,
+ * but small enough that the first event of a block reaches the consumer within max_latency if possible.
+ * Smaller batches mean shorter stalls when the drain thread copies them into the ports.
+ * The bounds are the preallocated block size, so tuning never allocates.
+ *
+ * update() and observeDrainLatency() are real-time safe and may only be called by the producing thread,
+ * the getters by any thread.
+ */
+class RTTIntrospectionBatchTuner
+{
+  public:
+	// weight of a new measurement in the moving averages
+	static constexpr double WEIGHT = 1.0 / 8.0;
+
+	RTTIntrospectionBatchTuner() : enabled(false),
+								   flush_budget(100.0),
+								   max_latency(100.0),
+								   min_batch(1),
+								   max_batch(1),
+								   block_count(2),
+								   budget_ticks(1),
+								   max_latency_ticks(1),
+								   event_rate(0),
+								   cycle_rate(0),
+								   drain_latency(0),
+								   batch_size(1),
+								   max_age(0)
+	{
+	}
+
+	/**
+	 * Not real-time safe. ticks_per_ms: ticks of the trace clock per millisecond.
+	 * max_batch is the preallocated size of a block, block_count the number of blocks in the pool.
+	 */
+	void configure(const double ticks_per_ms, const std::size_t min_batch, const std::size_t max_batch, const std::size_t block_count)
+	{
+		this->max_batch = max_batch > 0 ? max_batch : 1;
+		this->min_batch = min_batch < 1 ? 1 : (min_batch > this->max_batch ? this->max_batch : min_batch);
+		this->block_count = block_count > 2 ? block_count : 2;
+		// no budget if not positive
+		budget_ticks = flush_budget > 0 ? flush_budget * ticks_per_ms * 1E-6 : 0;
+		max_latency_ticks = max_latency * ticks_per_ms;
+		event_rate = 0;
+		cycle_rate = 0;
+		drain_latency.store(0, std::memory_order_relaxed);
+		// start with the full block until there are measurements
+		batch_size.store(this->max_batch, std::memory_order_relaxed);
+		max_age.store(static_cast<uint_least64_t>(max_latency_ticks), std::memory_order_relaxed);
+	}
+
+	/**
+	 * Time from publishing a block to its release by the consumer.
+	 */
+	inline void observeDrainLatency(const uint_least64_t latency)
+	{
+		double value = drain_latency.load(std::memory_order_relaxed);
+		average(value, static_cast<double>(latency));
+		// single writer, a load and a store suffice
+		drain_latency.store(value, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Called for each published block: events stored in cycles updateHook calls within age ticks,
+	 * flush_cost is the cost of publishing one block.
+	 */
+	inline void update(const std::size_t events, const uint_least64_t cycles, const uint_least64_t age, const double flush_cost)
+	{
+		if (events == 0 || age == 0)
+		{
+			return;
+		}
+		average(event_rate, static_cast<double>(events) / age);
+		average(cycle_rate, static_cast<double>(cycles > 0 ? cycles : 1) / age);
+
+		const double events_per_cycle = event_rate / cycle_rate;
+		const double latency = drain_latency.load(std::memory_order_relaxed);
+		// flushes per cycle * flush_cost <= budget
+		double lower = budget_ticks > 0 ? flush_cost * events_per_cycle / budget_ticks : 0;
+		// blocks in flight = drain_latency * event_rate / batch <= block_count / 2
+		const double in_flight = 2.0 * latency * event_rate / block_count;
+		lower = in_flight > lower ? in_flight : lower;
+		// age of the first event + drain latency <= max_latency
+		const double upper = event_rate * (max_latency_ticks - latency);
+		// smallest batch within the budget with some headroom, the budget and the pool are hard limits, the latency is not
+		double batch = 2.0 * lower;
+		batch = batch > upper ? upper : batch;
+		batch = batch < lower ? lower : batch;
+		batch = batch < min_batch ? min_batch : (batch > max_batch ? max_batch : batch);
+		batch_size.store(static_cast<std::size_t>(batch), std::memory_order_relaxed);
+
+		// partial blocks are flushed as well, but at most as often as the budget allows
+		double age_limit = max_latency_ticks - latency;
+		const double age_lower = budget_ticks > 0 ? flush_cost / (budget_ticks * cycle_rate) : 0;
+		age_limit = age_limit < age_lower ? age_lower : age_limit;
+		age_limit = age_limit < 1.0 ? 1.0 : age_limit;
+		max_age.store(static_cast<uint_least64_t>(age_limit), std::memory_order_relaxed);
+	}
+
+	inline std::size_t getBatchSize() const
+	{
+		return batch_size.load(std::memory_order_relaxed);
+	}
+
+	inline uint_least64_t getMaxAge() const
+	{
+		return max_age.load(std::memory_order_relaxed);
+	}
+
+	double getDrainLatency() const
+	{
+		return drain_latency.load(std::memory_order_relaxed);
+	}
+
+	// properties
+	bool enabled;
+	// ns per updateHook that may be spent on publishing blocks
+	double flush_budget;
+	// ms until an event should have reached the consumer
+	double max_latency;
+
+  private:
+	static inline void average(double &value, const double measured)
+	{
+		value = value > 0 ? value + (measured - value) * WEIGHT : measured;
+	}
+
+	std::size_t min_batch;
+	std::size_t max_batch;
+	std::size_t block_count;
+	double budget_ticks;
+	double max_latency_ticks;
+	// per tick, only used by the producing thread
+	double event_rate;
+	double cycle_rate;
+	// read by getDrainLatency() from other threads
+	std::atomic<double> drain_latency;
+	std::atomic<std::size_t> batch_size;
+	std::atomic<uint_least64_t> max_age;
+};
+
+} // namespace cogimon
+#endif
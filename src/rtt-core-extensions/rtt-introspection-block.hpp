@@ -0,0 +1,247 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_BLOCK_HPP
+#define RTT_INTROSPECTION_BLOCK_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rtt-introspection-trace.hpp"
+#include "rtt-introspection-clock.hpp"
+#include "rtt-introspection-memory.hpp"
+
+// RST-RT includes
+#include <rst-rt/monitoring/CallTraceSample.hpp>
+
+namespace cogimon
+{
+
+/**
+ * What a consumer needs to resolve the events of a block: the call names, the container name and the clock calibration.
+ * Never changed after it is created. The producer creates a new table in each configureHook, blocks that are in flight
+ * keep the one they were sent with, so that they can still be read after the producer was reconfigured.
+ */
+struct CallTraceNameTable
+{
+	CallTraceNameTable(const std::vector<std::string> &names, const std::string &container_name, const RTTIntrospectionClock &clock) : names(names),
+																																	   container_name(container_name),
+																																	   clock(clock)
+	{
+	}
+
+	const std::string &getName(const uint16_t id) const
+	{
+		if (id < names.size())
+		{
+			return names[id];
+		}
+		return names[RTTIntrospectionNameRegistry::UNREGISTERED_ID];
+	}
+
+	const std::vector<std::string> names;
+	const std::string container_name;
+	const RTTIntrospectionClock clock;
+};
+
+/**
+ * Preallocated block of call trace events.
+ * The real-time thread writes the events directly into the block, afterwards only its pointer is handed
+ * over (to the drain thread and from there through out_call_trace_block_port to the IntrospectionReporter).
+ * Whoever consumes the block last has to call release(), which returns it to the pool.
+ *
+ * The drain thread attaches the name table when it hands the block over, the real-time thread never touches it.
+ * The events themselves live in the pool of the producer, see RTTIntrospectionBlockPool::abandon().
+ */
+struct CallTraceBlock
+{
+	enum State
+	{
+		BLOCK_FREE = 0,
+		BLOCK_FILLING = 1,
+		BLOCK_IN_FLIGHT = 2
+	};
+
+	CallTraceBlock() : size(0), publish_time(0), release_latency(0), sequence(0), state(BLOCK_FREE)
+	{
+	}
+
+	CallTraceBlock(const CallTraceBlock &other) : events(other.events),
+												  size(other.size),
+												  name_table(other.name_table),
+												  publish_time(other.publish_time),
+												  release_latency(other.release_latency),
+												  sequence(other.sequence),
+												  state(other.state.load())
+	{
+	}
+
+	void release()
+	{
+		// only measured if the producer set publish_time, it reads the latency when it acquires the block again
+		release_latency = name_table && publish_time > 0 && state.load(std::memory_order_relaxed) == BLOCK_IN_FLIGHT ? name_table->clock.now() - publish_time : 0;
+		state.store(BLOCK_FREE, std::memory_order_release);
+	}
+
+	/**
+	 * Resolves name and time of an event. Not real-time safe.
+	 */
+	void toCallTraceSample(const CallTraceEvent &cte, rstrt::monitoring::CallTraceSample &cts) const
+	{
+		cts.call_name = name_table->getName(cte.call_name_id);
+		cts.container_name = name_table->container_name;
+		cts.call_time = name_table->clock.toNSecs(cte.call_time);
+		cts.call_duration = cte.call_duration > 0 ? name_table->clock.toNSecs(cte.call_duration) : 0;
+		cts.call_type = static_cast<rstrt::monitoring::CallTraceSample::CallType>(cte.call_type);
+	}
+
+	/**
+	 * Sample that carries the sampling factor (in call_duration), see RTTIntrospectionSampler.
+	 */
+	void toSamplingFactorSample(const CallTraceEvent &cte, rstrt::monitoring::CallTraceSample &cts) const
+	{
+		cts.call_name = SAMPLING_FACTOR_NAME;
+		cts.container_name = name_table->container_name;
+		cts.call_time = name_table->clock.toNSecs(cte.call_time);
+		cts.call_duration = cte.sampling_factor;
+		cts.call_type = rstrt::monitoring::CallTraceSample::CALL_UNIVERSAL;
+	}
+
+	// page-aligned, so that RTTIntrospectionMemoryLock locks all of it
+	std::vector<CallTraceEvent, RTTIntrospectionPageAllocator<CallTraceEvent>> events;
+	std::size_t size;
+
+	std::shared_ptr<const CallTraceNameTable> name_table;
+
+	// raw timestamp of the hand over, and the time from there until release() (see RTTIntrospectionBatchTuner)
+	uint_least64_t publish_time;
+	uint_least64_t release_latency;
+	// batch sequence number, set by the drain thread when it hands the block over (see CallTraceAccountingIndex)
+	uint_least64_t sequence;
+
+	std::atomic<int> state;
+};
+
+/**
+ * Fixed set of CallTraceBlocks that are reused in round-robin order.
+ * acquire() may only be called by one thread, release() by any thread.
+ */
+class RTTIntrospectionBlockPool
+{
+  public:
+	// upper bound, so that consumers can size their buffers to never lose a block pointer
+	static const std::size_t MAX_BLOCKS = 1024;
+
+	RTTIntrospectionBlockPool() : next(0)
+	{
+	}
+
+	/**
+	 * Not real-time safe. Fails if blocks of the previous allocation are still in use.
+	 */
+	bool resize(const std::size_t block_count, const std::size_t block_size, const CallTraceBlock &prototype)
+	{
+		if (inUse() > 0)
+		{
+			return false;
+		}
+		const std::size_t count = block_count < 2 ? 2 : (block_count > MAX_BLOCKS ? MAX_BLOCKS : block_count);
+		std::vector<CallTraceBlock>(count, prototype).swap(blocks);
+		for (CallTraceBlock &block : blocks)
+		{
+			block.events.resize(block_size > 0 ? block_size : 1);
+			block.size = 0;
+			block.publish_time = 0;
+			block.release_latency = 0;
+			block.state.store(CallTraceBlock::BLOCK_FREE);
+		}
+		next = 0;
+		return true;
+	}
+
+	/**
+	 * Real-time safe, returns 0 if all blocks are in use.
+	 */
+	inline CallTraceBlock *acquire()
+	{
+		for (std::size_t i = 0; i < blocks.size(); i++)
+		{
+			CallTraceBlock &block = blocks[next];
+			next = next + 1 < blocks.size() ? next + 1 : 0;
+			if (block.state.load(std::memory_order_acquire) == CallTraceBlock::BLOCK_FREE)
+			{
+				block.state.store(CallTraceBlock::BLOCK_FILLING, std::memory_order_relaxed);
+				block.size = 0;
+				return &block;
+			}
+		}
+		return 0;
+	}
+
+	std::size_t inUse() const
+	{
+		std::size_t used = 0;
+		for (const CallTraceBlock &block : blocks)
+		{
+			if (block.state.load(std::memory_order_acquire) == CallTraceBlock::BLOCK_IN_FLIGHT)
+			{
+				used++;
+			}
+		}
+		return used;
+	}
+
+	std::size_t size() const
+	{
+		return blocks.size();
+	}
+
+	/**
+	 * Not real-time safe. Gives the blocks up without freeing them, for a producer that is destroyed while a consumer
+	 * still holds some of them. The memory is leaked on purpose, so that the consumer can still read and release them.
+	 */
+	void abandon()
+	{
+		(new std::vector<CallTraceBlock>())->swap(blocks);
+		next = 0;
+	}
+
+	const std::vector<CallTraceBlock> &getBlocks() const
+	{
+		return blocks;
+	}
+
+  private:
+	std::vector<CallTraceBlock> blocks;
+	std::size_t next;
+};
+
+} // namespace cogimon
+#endif
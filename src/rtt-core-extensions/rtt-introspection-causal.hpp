@@ -0,0 +1,228 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_CAUSAL_HPP
+#define RTT_INTROSPECTION_CAUSAL_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cogimon
+{
+
+/**
+ * Where a sample in a pipeline came from: the sequence number and the write time (TimeService ns) of the sample that
+ * entered the pipeline at origin_source, an output port of the RTTIntrospectionCausalRegistry.
+ * A sequence of 0 means no context.
+ */
+struct CausalContext
+{
+	CausalContext() : sequence(0), origin_time(0), origin_source(0)
+	{
+	}
+
+	uint64_t sequence;
+	uint64_t origin_time;
+	uint32_t origin_source;
+};
+
+/**
+ * One hop of a causal chain, sent on out_causal_trace_port by the reading component.
+ * The times are TimeService ns, so that they can be compared across components.
+ * Hop latency: read_time - write_time, end-to-end latency: read_time - origin_time.
+ */
+struct CallTraceCausalSample
+{
+	uint64_t sequence;
+	uint64_t origin_time;
+	// of the upstream output port
+	uint64_t write_time;
+	uint64_t read_time;
+	// ids of the RTTIntrospectionCausalRegistry
+	uint32_t origin_source;
+	uint32_t upstream_source;
+	uint32_t reader_source;
+	uint16_t component_id;
+	uint16_t reserved;
+};
+
+/**
+ * Causal context of the last sample written to an output port.
+ * Written by the thread of the owning component only, read by the connected components with a sequence lock,
+ * so neither side blocks.
+ */
+class RTTIntrospectionCausalSlot
+{
+  public:
+	RTTIntrospectionCausalSlot() : version(0), sequence(0), origin_time(0), write_time(0), origin_source(0)
+	{
+	}
+
+	inline void write(const CausalContext &context, const uint64_t time)
+	{
+		const uint32_t v = version.load(std::memory_order_relaxed);
+		// odd while writing
+		version.store(v + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		sequence.store(context.sequence, std::memory_order_relaxed);
+		origin_time.store(context.origin_time, std::memory_order_relaxed);
+		origin_source.store(context.origin_source, std::memory_order_relaxed);
+		write_time.store(time, std::memory_order_relaxed);
+		version.store(v + 2, std::memory_order_release);
+	}
+
+	/**
+	 * Returns false if there is no context or the writer kept interfering.
+	 */
+	inline bool read(CausalContext &context, uint64_t &time) const
+	{
+		for (unsigned int attempt = 0; attempt < 8; attempt++)
+		{
+			const uint32_t v = version.load(std::memory_order_acquire);
+			if (v & 1)
+			{
+				continue;
+			}
+			context.sequence = sequence.load(std::memory_order_relaxed);
+			context.origin_time = origin_time.load(std::memory_order_relaxed);
+			context.origin_source = origin_source.load(std::memory_order_relaxed);
+			time = write_time.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (version.load(std::memory_order_relaxed) == v)
+			{
+				return context.sequence != 0;
+			}
+		}
+		return false;
+	}
+
+  private:
+	std::atomic<uint32_t> version;
+	std::atomic<uint64_t> sequence;
+	std::atomic<uint64_t> origin_time;
+	std::atomic<uint64_t> write_time;
+	std::atomic<uint32_t> origin_source;
+};
+
+/**
+ * Causal tracing state of one port of a component.
+ * Output ports write their slot, input ports read the slot of the output port they are connected to.
+ */
+struct RTTIntrospectionCausalPort
+{
+	RTTIntrospectionCausalPort() : source(0), slot(0), upstream_source(0), upstream(0)
+	{
+	}
+
+	uint32_t source;
+	RTTIntrospectionCausalSlot *slot;
+	// 0 if the input port is not connected to a registered output port in this process
+	uint32_t upstream_source;
+	const RTTIntrospectionCausalSlot *upstream;
+};
+
+/**
+ * Process-wide ids ("<component>.<port>") and slots of the ports of all RTTIntrospectionBase components.
+ * Ids start at 1 and are kept for the lifetime of the process, so the reporter can still resolve them after a
+ * component is gone. Registering and looking up is not real-time safe, the components keep the slot pointers.
+ */
+class RTTIntrospectionCausalRegistry
+{
+  public:
+	static RTTIntrospectionCausalRegistry &instance();
+
+	RTTIntrospectionCausalRegistry() : sequence(0)
+	{
+	}
+
+	// returns the id the port already has, with the name updated
+	uint32_t registerSource(const void *port, const std::string &name)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::map<const void *, uint32_t>::const_iterator it = ids.find(port);
+		if (it != ids.end())
+		{
+			names[it->second - 1] = name;
+			return it->second;
+		}
+		slots.emplace_back();
+		names.push_back(name);
+		const uint32_t id = static_cast<uint32_t>(names.size());
+		ids[port] = id;
+		return id;
+	}
+
+	// the id and slot stay valid, only the port can not be found anymore (it may be reused by a new port)
+	void unregisterSource(const void *port)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		ids.erase(port);
+	}
+
+	// 0 if the port is not registered
+	uint32_t findSource(const void *port) const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::map<const void *, uint32_t>::const_iterator it = ids.find(port);
+		return it != ids.end() ? it->second : 0;
+	}
+
+	// stable address, never freed
+	RTTIntrospectionCausalSlot *getSlot(const uint32_t id)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return id > 0 && id <= slots.size() ? &slots[id - 1] : 0;
+	}
+
+	std::string getName(const uint32_t id) const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return id > 0 && id <= names.size() ? names[id - 1] : "<unknown>";
+	}
+
+	// real-time safe
+	inline uint64_t nextSequence()
+	{
+		return sequence.fetch_add(1, std::memory_order_relaxed) + 1;
+	}
+
+  private:
+	mutable std::mutex mutex;
+	std::map<const void *, uint32_t> ids;
+	// a deque does not move its elements on emplace_back
+	std::deque<RTTIntrospectionCausalSlot> slots;
+	std::vector<std::string> names;
+	std::atomic<uint64_t> sequence;
+};
+
+} // namespace cogimon
+#endif
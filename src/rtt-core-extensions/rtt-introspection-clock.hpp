@@ -0,0 +1,209 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_CLOCK_HPP
+#define RTT_INTROSPECTION_CLOCK_HPP
+
+#include <stdint.h>
+#include <time.h>
+#include <rtt/os/TimeService.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#define RTT_INTROSPECTION_HAS_TSC
+#endif
+
+namespace cogimon
+{
+
+/**
+ * Timestamp source for the call traces.
+ * With CLOCK_SOURCE_TSC the real-time thread only reads the invariant time stamp counter,
+ * the raw values are converted to the nanoseconds of the RTT::os::TimeService outside of the real-time thread.
+ * The conversion is calibrated against CLOCK_MONOTONIC in calibrate(), which is not real-time safe.
+ */
+class RTTIntrospectionClock
+{
+  public:
+	enum ClockSource
+	{
+		CLOCK_SOURCE_TIMESERVICE = 0,
+		CLOCK_SOURCE_TSC = 1
+	};
+
+	RTTIntrospectionClock() : source(CLOCK_SOURCE_TIMESERVICE),
+							  ns_per_tick(1.0),
+							  offset_ticks(0),
+							  offset_ns(0)
+	{
+		time_service = RTT::os::TimeService::Instance();
+	}
+
+	/**
+	 * Returns false if the source is not available on this machine.
+	 */
+	bool setSource(const ClockSource new_source)
+	{
+		if (new_source == CLOCK_SOURCE_TSC && !hasInvariantTSC())
+		{
+			source = CLOCK_SOURCE_TIMESERVICE;
+			return false;
+		}
+		source = new_source;
+		calibrate();
+		return true;
+	}
+
+	ClockSource getSource() const
+	{
+		return source;
+	}
+
+	static bool hasInvariantTSC()
+	{
+#ifdef RTT_INTROSPECTION_HAS_TSC
+		unsigned int eax, ebx, ecx, edx;
+		if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007)
+		{
+			return false;
+		}
+		__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+		return (edx & (1 << 8)) != 0;
+#else
+		return false;
+#endif
+	}
+
+	/**
+	 * Measures the TSC frequency against CLOCK_MONOTONIC and aligns the TSC to the time service.
+	 * Blocks for about calibration_ns.
+	 */
+	void calibrate(const uint_least64_t calibration_ns = 20000000)
+	{
+		if (source != CLOCK_SOURCE_TSC)
+		{
+			ns_per_tick = 1.0;
+			offset_ticks = 0;
+			offset_ns = 0;
+			return;
+		}
+		const uint_least64_t mono_start = monotonicNSecs();
+		const uint_least64_t tsc_start = now();
+		uint_least64_t mono_end = mono_start;
+		while (mono_end - mono_start < calibration_ns)
+		{
+			mono_end = monotonicNSecs();
+		}
+		const uint_least64_t tsc_end = now();
+		ns_per_tick = static_cast<double>(mono_end - mono_start) / static_cast<double>(tsc_end - tsc_start);
+
+		offset_ticks = now();
+		offset_ns = time_service->getNSecs();
+	}
+
+	/**
+	 * Real-time safe, raw value of the selected source.
+	 */
+	inline uint_least64_t now() const
+	{
+#ifdef RTT_INTROSPECTION_HAS_TSC
+		if (source == CLOCK_SOURCE_TSC)
+		{
+			return __rdtsc();
+		}
+#endif
+		return time_service->getNSecs();
+	}
+
+	/**
+	 * Converts a raw timestamp from now() into the nanoseconds of the time service.
+	 */
+	inline uint_least64_t toNSecs(const uint_least64_t raw) const
+	{
+		if (source != CLOCK_SOURCE_TSC)
+		{
+			return raw;
+		}
+		return offset_ns + static_cast<int_least64_t>(static_cast<double>(static_cast<int_least64_t>(raw - offset_ticks)) * ns_per_tick);
+	}
+
+	/**
+	 * Converts a nanosecond timestamp of the time service into a raw timestamp.
+	 */
+	inline uint_least64_t fromNSecs(const uint_least64_t ns) const
+	{
+		if (source != CLOCK_SOURCE_TSC)
+		{
+			return ns;
+		}
+		return offset_ticks + static_cast<int_least64_t>(static_cast<double>(static_cast<int_least64_t>(ns - offset_ns)) / ns_per_tick);
+	}
+
+	/**
+	 * Converts the difference of two raw timestamps into nanoseconds.
+	 */
+	inline uint_least64_t durationToNSecs(const uint_least64_t raw_duration) const
+	{
+		if (source != CLOCK_SOURCE_TSC)
+		{
+			return raw_duration;
+		}
+		return static_cast<uint_least64_t>(static_cast<double>(raw_duration) * ns_per_tick);
+	}
+
+	inline uint_least64_t durationFromNSecs(const uint_least64_t ns_duration) const
+	{
+		if (source != CLOCK_SOURCE_TSC)
+		{
+			return ns_duration;
+		}
+		return static_cast<uint_least64_t>(static_cast<double>(ns_duration) / ns_per_tick);
+	}
+
+	double getNSecsPerTick() const
+	{
+		return ns_per_tick;
+	}
+
+  private:
+	static uint_least64_t monotonicNSecs()
+	{
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return static_cast<uint_least64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+	}
+
+	RTT::os::TimeService *time_service;
+	ClockSource source;
+	double ns_per_tick;
+	uint_least64_t offset_ticks;
+	uint_least64_t offset_ns;
+};
+
+} // namespace cogimon
+#endif
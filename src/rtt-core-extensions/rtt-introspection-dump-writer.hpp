@@ -0,0 +1,137 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_DUMP_WRITER_HPP
+#define RTT_INTROSPECTION_DUMP_WRITER_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rtt/Logger.hpp>
+
+#include "rtt-introspection-dump.hpp"
+
+namespace cogimon
+{
+
+/**
+ * Writes RTTIntrospectionDumps in a background thread, so that the caller never waits for the disk.
+ * The thread is started with the first dump, the destructor writes the pending dumps and joins it.
+ */
+class RTTIntrospectionDumpWriter
+{
+  public:
+	RTTIntrospectionDumpWriter() : running(false)
+	{
+	}
+
+	~RTTIntrospectionDumpWriter()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			running = false;
+		}
+		condition.notify_one();
+		if (thread.joinable())
+		{
+			thread.join();
+		}
+	}
+
+	/**
+	 * Takes over the values (the vector is left empty). Not real-time safe, but does not block on I/O.
+	 */
+	void dump(const std::string &file_name, std::vector<uint64_t> &values, const double ns_per_unit, const uint64_t dump_time)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(Job());
+			jobs.back().file_name = file_name;
+			jobs.back().values.swap(values);
+			jobs.back().ns_per_unit = ns_per_unit;
+			jobs.back().dump_time = dump_time;
+			if (!running)
+			{
+				running = true;
+				thread = std::thread(&RTTIntrospectionDumpWriter::run, this);
+			}
+		}
+		condition.notify_one();
+	}
+
+  private:
+	struct Job
+	{
+		std::string file_name;
+		std::vector<uint64_t> values;
+		double ns_per_unit;
+		uint64_t dump_time;
+	};
+
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			condition.wait(lock, [this] { return !jobs.empty() || !running; });
+			if (jobs.empty())
+			{
+				return;
+			}
+			Job job;
+			job.file_name.swap(jobs.front().file_name);
+			job.values.swap(jobs.front().values);
+			job.ns_per_unit = jobs.front().ns_per_unit;
+			job.dump_time = jobs.front().dump_time;
+			jobs.pop_front();
+
+			lock.unlock();
+			if (writeIntrospectionDump(job.file_name, job.values, job.ns_per_unit, job.dump_time))
+			{
+				RTT::log(RTT::Info) << "Wrote " << job.values.size() << " values to " << job.file_name << RTT::endlog();
+			}
+			else
+			{
+				RTT::log(RTT::Error) << "Could not write " << job.file_name << RTT::endlog();
+			}
+			lock.lock();
+		}
+	}
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<Job> jobs;
+	bool running;
+	std::thread thread;
+};
+
+} // namespace cogimon
+#endif
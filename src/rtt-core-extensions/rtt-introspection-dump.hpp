@@ -0,0 +1,106 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_DUMP_HPP
+#define RTT_INTROSPECTION_DUMP_HPP
+
+#include <stdint.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace cogimon
+{
+
+/**
+ * Binary dump of raw 64 bit values (e.g. RTTIntrospectionBase::executionTimes):
+ * this header followed by count little-endian uint64_t values.
+ * Multiplying a value with ns_per_unit gives nanoseconds.
+ * Only depends on the standard library, so that offline tools can read it.
+ */
+struct RTTIntrospectionDumpHeader
+{
+	static const uint32_t VERSION = 1;
+
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	uint64_t count;
+	double ns_per_unit;
+	// RTT::os::TimeService ns when the dump was requested
+	uint64_t dump_time;
+};
+
+static const char RTT_INTROSPECTION_DUMP_MAGIC[8] = {'R', 'T', 'T', 'I', 'D', 'M', 'P', '\0'};
+
+inline bool writeIntrospectionDump(const std::string &file_name, const std::vector<uint64_t> &values, const double ns_per_unit, const uint64_t dump_time)
+{
+	RTTIntrospectionDumpHeader header;
+	std::memcpy(header.magic, RTT_INTROSPECTION_DUMP_MAGIC, sizeof(header.magic));
+	header.version = RTTIntrospectionDumpHeader::VERSION;
+	header.header_size = sizeof(RTTIntrospectionDumpHeader);
+	header.count = values.size();
+	header.ns_per_unit = ns_per_unit;
+	header.dump_time = dump_time;
+
+	FILE *file = std::fopen(file_name.c_str(), "wb");
+	if (!file)
+	{
+		return false;
+	}
+	bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+	if (ok && !values.empty())
+	{
+		ok = std::fwrite(values.data(), sizeof(uint64_t), values.size(), file) == values.size();
+	}
+	return std::fclose(file) == 0 && ok;
+}
+
+inline bool readIntrospectionDump(const std::string &file_name, RTTIntrospectionDumpHeader &header, std::vector<uint64_t> &values)
+{
+	FILE *file = std::fopen(file_name.c_str(), "rb");
+	if (!file)
+	{
+		return false;
+	}
+	bool ok = std::fread(&header, sizeof(header), 1, file) == 1 &&
+			  std::memcmp(header.magic, RTT_INTROSPECTION_DUMP_MAGIC, sizeof(header.magic)) == 0 &&
+			  header.version == RTTIntrospectionDumpHeader::VERSION &&
+			  header.header_size >= sizeof(header) &&
+			  std::fseek(file, header.header_size, SEEK_SET) == 0;
+	if (ok)
+	{
+		values.resize(header.count);
+		ok = header.count == 0 || std::fread(&values[0], sizeof(uint64_t), header.count, file) == header.count;
+	}
+	std::fclose(file);
+	return ok;
+}
+
+} // namespace cogimon
+#endif
@@ -0,0 +1,128 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_HANDOVER_HPP
+#define RTT_INTROSPECTION_HANDOVER_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "rtt-introspection-ring.hpp"
+
+namespace cogimon
+{
+
+/**
+ * Hands preallocated objects from any number of non real-time threads to exactly one reader thread
+ * (the real-time thread or the drain thread), RCU style:
+ *
+ * - update() prepares the pending object outside of the reader (merging into one that was not taken yet).
+ * - The reader takes it at its own boundary (e.g. the start of a cycle), adopts it and hands the object it replaced
+ *   back with retire(). take() and retire() never block or allocate.
+ * - Retired objects are freed by the next update() or by the destructor, i.e. never by the reader.
+ */
+template <class T>
+class RTTIntrospectionHandover
+{
+  public:
+	RTTIntrospectionHandover() : pending(0)
+	{
+		// take() only succeeds if there is room, so a few slots are enough
+		retired.resize(RETIRED_SLOTS, static_cast<T *>(0));
+	}
+
+	~RTTIntrospectionHandover()
+	{
+		collect();
+		delete pending.exchange(0);
+	}
+
+	/**
+	 * Any non real-time thread. f(T &) sets the requested fields on the pending object,
+	 * which is either the one that was not taken yet or a new default constructed one.
+	 */
+	template <class F>
+	void update(F f)
+	{
+		std::lock_guard<std::mutex> lock(writer);
+		collect();
+		std::unique_ptr<T> next(pending.exchange(0, std::memory_order_acq_rel));
+		if (!next)
+		{
+			next.reset(new T());
+		}
+		f(*next);
+		pending.store(next.release(), std::memory_order_release);
+	}
+
+	/**
+	 * Reader: returns the pending object or 0. The caller owns it until retire().
+	 */
+	inline T *take()
+	{
+		if (pending.load(std::memory_order_relaxed) == 0 || retired.size() >= RETIRED_SLOTS)
+		{
+			return 0;
+		}
+		return pending.exchange(0, std::memory_order_acq_rel);
+	}
+
+	/**
+	 * Reader: hands back an object returned by take() (or the one it replaced) for deletion.
+	 */
+	inline void retire(T *object)
+	{
+		// there is room, see take()
+		retired.push(object);
+	}
+
+	bool isPending() const
+	{
+		return pending.load(std::memory_order_relaxed) != 0;
+	}
+
+  private:
+	static const std::size_t RETIRED_SLOTS = 4;
+
+	void collect()
+	{
+		T **object = 0;
+		while ((object = retired.front()) != 0)
+		{
+			delete *object;
+			retired.pop();
+		}
+	}
+
+	std::mutex writer;
+	std::atomic<T *> pending;
+	RTTIntrospectionRing<T *> retired;
+};
+
+} // namespace cogimon
+#endif
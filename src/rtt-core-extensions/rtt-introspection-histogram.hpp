@@ -0,0 +1,148 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_HISTOGRAM_HPP
+#define RTT_INTROSPECTION_HISTOGRAM_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+
+namespace cogimon
+{
+
+/**
+ * Fixed-memory histogram with logarithmic buckets (HDR style).
+ * Each power of two is split into 2^SUB_BUCKET_BITS linear sub-buckets, which bounds the relative error to about 3%.
+ * record() is O(1) and real-time safe, it may only be called by one thread.
+ * The statistics can be read from another thread while recording.
+ */
+class RTTIntrospectionHistogram
+{
+  public:
+	static const unsigned int SUB_BUCKET_BITS = 5;
+	static const std::size_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+	static const std::size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+	RTTIntrospectionHistogram()
+	{
+		reset();
+	}
+
+	/**
+	 * Not real-time safe with respect to a concurrent record().
+	 */
+	void reset()
+	{
+		for (std::size_t i = 0; i < BUCKET_COUNT; i++)
+		{
+			counts[i].store(0, std::memory_order_relaxed);
+		}
+		total.store(0, std::memory_order_relaxed);
+		max.store(0, std::memory_order_relaxed);
+	}
+
+	inline void record(const uint_least64_t value)
+	{
+		std::atomic<uint_least64_t> &c = counts[bucketIndex(value)];
+		// single writer, so no read-modify-write instruction needed
+		c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		total.store(total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		if (value > max.load(std::memory_order_relaxed))
+		{
+			max.store(value, std::memory_order_relaxed);
+		}
+	}
+
+	uint_least64_t getCount() const
+	{
+		return total.load(std::memory_order_relaxed);
+	}
+
+	uint_least64_t getMax() const
+	{
+		return max.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Returns the highest value that is equivalent to the given percentile (0-100).
+	 */
+	uint_least64_t getPercentile(const double percentile) const
+	{
+		const uint_least64_t count = getCount();
+		if (count == 0)
+		{
+			return 0;
+		}
+		uint_least64_t rank = static_cast<uint_least64_t>(percentile / 100.0 * count + 0.5);
+		if (rank < 1)
+		{
+			rank = 1;
+		}
+		uint_least64_t seen = 0;
+		for (std::size_t i = 0; i < BUCKET_COUNT; i++)
+		{
+			seen += counts[i].load(std::memory_order_relaxed);
+			if (seen >= rank)
+			{
+				const uint_least64_t upper = bucketUpperBound(i);
+				return upper < getMax() ? upper : getMax();
+			}
+		}
+		return getMax();
+	}
+
+	static inline std::size_t bucketIndex(const uint_least64_t value)
+	{
+		if (value < SUB_BUCKET_COUNT)
+		{
+			return static_cast<std::size_t>(value);
+		}
+		const unsigned int msb = 63 - __builtin_clzll(value);
+		const unsigned int shift = msb - SUB_BUCKET_BITS;
+		return (shift + 1) * SUB_BUCKET_COUNT + ((value >> shift) & (SUB_BUCKET_COUNT - 1));
+	}
+
+	static inline uint_least64_t bucketUpperBound(const std::size_t index)
+	{
+		if (index < SUB_BUCKET_COUNT)
+		{
+			return index;
+		}
+		const unsigned int shift = index / SUB_BUCKET_COUNT - 1;
+		const uint_least64_t lower = (static_cast<uint_least64_t>(SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT)) << shift;
+		return lower + ((static_cast<uint_least64_t>(1) << shift) - 1);
+	}
+
+  private:
+	std::atomic<uint_least64_t> counts[BUCKET_COUNT];
+	std::atomic<uint_least64_t> total;
+	std::atomic<uint_least64_t> max;
+};
+
+} // namespace cogimon
+#endif
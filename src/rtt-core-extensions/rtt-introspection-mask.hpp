@@ -0,0 +1,159 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_MASK_HPP
+#define RTT_INTROSPECTION_MASK_HPP
+
+#include <stdint.h>
+#include <fnmatch.h>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cogimon
+{
+
+/**
+ * Enable bit per call name id (ports, hooks and TraceScopes of RTTIntrospectionNameRegistry), all set by default.
+ *
+ * select() may be called by any non real-time thread, it writes a pending copy of the bitmap guarded by a sequence counter.
+ * The real-time thread picks the pending copy up with update() at the start of a cycle, so the mask does not change
+ * within a cycle and neither side ever blocks. update() and isEnabled() may only be called by the real-time thread.
+ */
+class RTTIntrospectionTraceMask
+{
+  public:
+	RTTIntrospectionTraceMask() : words(0), generation(0), seen(0)
+	{
+	}
+
+	/**
+	 * Not real-time safe and not while the real-time thread uses the mask. Enables all ids.
+	 */
+	void resize(const std::size_t ids)
+	{
+		std::lock_guard<std::mutex> lock(writer);
+		words = (ids + 63) / 64;
+		pending.reset(words > 0 ? new std::atomic<uint64_t>[words] : 0);
+		active.assign(words, ~static_cast<uint64_t>(0));
+		for (std::size_t i = 0; i < words; i++)
+		{
+			pending[i].store(~static_cast<uint64_t>(0), std::memory_order_relaxed);
+		}
+		seen = generation.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Sets the bit of every name that matches the shell pattern (e.g. "robot_*"). names is indexed by id.
+	 * Returns the number of matching names. Not real-time safe.
+	 */
+	std::size_t select(const std::vector<std::string> &names, const std::string &pattern, const bool enable)
+	{
+		std::lock_guard<std::mutex> lock(writer);
+		// odd while writing
+		const unsigned int g = generation.load(std::memory_order_relaxed);
+		generation.store(g + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		std::size_t matches = 0;
+		for (std::size_t id = 0; id < names.size() && id / 64 < words; id++)
+		{
+			if (fnmatch(pattern.c_str(), names[id].c_str(), 0) != 0)
+			{
+				continue;
+			}
+			matches++;
+			const uint64_t bit = static_cast<uint64_t>(1) << (id % 64);
+			const uint64_t word = pending[id / 64].load(std::memory_order_relaxed);
+			pending[id / 64].store(enable ? word | bit : word & ~bit, std::memory_order_relaxed);
+		}
+		generation.store(g + 2, std::memory_order_release);
+		return matches;
+	}
+
+	/**
+	 * Takes over the pending bitmap if it changed and is not being written. Real-time safe.
+	 */
+	inline void update()
+	{
+		const unsigned int g = generation.load(std::memory_order_acquire);
+		if (g == seen || (g & 1))
+		{
+			return;
+		}
+		for (std::size_t i = 0; i < words; i++)
+		{
+			active[i] = pending[i].load(std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		// otherwise retry in the next cycle
+		if (generation.load(std::memory_order_relaxed) == g)
+		{
+			seen = g;
+		}
+	}
+
+	/**
+	 * Ids that were registered after resize() are enabled.
+	 */
+	inline bool isEnabled(const uint16_t id) const
+	{
+		return static_cast<std::size_t>(id / 64) >= words || ((active[id / 64] >> (id % 64)) & 1);
+	}
+
+	/**
+	 * Not real-time safe, names is indexed by id.
+	 */
+	std::vector<std::string> getEnabled(const std::vector<std::string> &names)
+	{
+		std::lock_guard<std::mutex> lock(writer);
+		std::vector<std::string> enabled;
+		for (std::size_t id = 0; id < names.size(); id++)
+		{
+			if (id / 64 >= words || ((pending[id / 64].load(std::memory_order_relaxed) >> (id % 64)) & 1))
+			{
+				enabled.push_back(names[id]);
+			}
+		}
+		return enabled;
+	}
+
+  private:
+	std::size_t words;
+	// written by select()
+	std::unique_ptr<std::atomic<uint64_t>[]> pending;
+	std::atomic<unsigned int> generation;
+	// only accessed by the real-time thread
+	std::vector<uint64_t> active;
+	unsigned int seen;
+	std::mutex writer;
+};
+
+} // namespace cogimon
+#endif
@@ -0,0 +1,237 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_MEMORY_HPP
+#define RTT_INTROSPECTION_MEMORY_HPP
+
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace cogimon
+{
+
+/**
+ * Allocates whole, page-aligned pages, so that a buffer does not share a page with any other allocation
+ * and RTTIntrospectionMemoryLock can lock all of it.
+ */
+template <class T>
+struct RTTIntrospectionPageAllocator
+{
+	typedef T value_type;
+
+	RTTIntrospectionPageAllocator()
+	{
+	}
+
+	template <class U>
+	RTTIntrospectionPageAllocator(const RTTIntrospectionPageAllocator<U> &)
+	{
+	}
+
+	T *allocate(const std::size_t n)
+	{
+		void *memory = 0;
+		if (posix_memalign(&memory, pageSize(), allocationSize(n)) != 0)
+		{
+			throw std::bad_alloc();
+		}
+		return static_cast<T *>(memory);
+	}
+
+	void deallocate(T *memory, const std::size_t)
+	{
+		std::free(memory);
+	}
+
+	// bytes that are allocated for n elements
+	static std::size_t allocationSize(const std::size_t n)
+	{
+		return (n * sizeof(T) + pageSize() - 1) & ~(pageSize() - 1);
+	}
+
+	static std::size_t pageSize()
+	{
+		static const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+		return page;
+	}
+};
+
+template <class T, class U>
+bool operator==(const RTTIntrospectionPageAllocator<T> &, const RTTIntrospectionPageAllocator<U> &)
+{
+	return true;
+}
+
+template <class T, class U>
+bool operator!=(const RTTIntrospectionPageAllocator<T> &, const RTTIntrospectionPageAllocator<U> &)
+{
+	return false;
+}
+
+/**
+ * Prefaults and mlocks preallocated buffers, so that the first pass through them does not page-fault in the real-time thread.
+ * mlock faults all pages of a writable range in. If it fails (usually RLIMIT_MEMLOCK), every page is written once
+ * (with its own content) instead, then the pages are resident but may be swapped out again. Not real-time safe.
+ *
+ * Locks do not nest: one munlock unlocks a page regardless of how many mlock calls covered it. Therefore only the pages
+ * that lie entirely inside a range are locked. The partial pages at its ends may belong to other allocations, whose
+ * owners could lock them as well, so they are only prefaulted and unlock() never touches them.
+ * Buffers that are written by the real-time thread use RTTIntrospectionPageAllocator to be locked completely.
+ */
+class RTTIntrospectionMemoryLock
+{
+  public:
+	RTTIntrospectionMemoryLock() : locked(0), prefaulted(0), error(0)
+	{
+	}
+
+	~RTTIntrospectionMemoryLock()
+	{
+		unlock();
+	}
+
+	/**
+	 * Returns true if all whole pages of the range were locked.
+	 * Only pass prefault = false for memory that was already written, e.g. a constructed object that other threads modify.
+	 */
+	bool lock(const void *data, const std::size_t bytes, const bool prefault = true)
+	{
+		if (!data || bytes == 0)
+		{
+			return true;
+		}
+		static const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+		const uintptr_t first = reinterpret_cast<uintptr_t>(data);
+		const uintptr_t last = first + bytes;
+		// the whole pages inside the range
+		const uintptr_t begin = (first + page - 1) & ~(page - 1);
+		const uintptr_t end = last & ~(page - 1);
+		prefaulted += ((last + page - 1) & ~(page - 1)) - (first & ~(page - 1));
+		if (begin >= end)
+		{
+			if (prefault)
+			{
+				prefaultRange(first, last, page);
+			}
+			return true;
+		}
+		if (prefault)
+		{
+			prefaultRange(first, begin, page);
+			prefaultRange(end, last, page);
+		}
+		if (mlock(reinterpret_cast<const void *>(begin), end - begin) == 0)
+		{
+			regions.push_back(std::make_pair(begin, end - begin));
+			locked += end - begin;
+			return true;
+		}
+		error = errno;
+		if (prefault)
+		{
+			prefaultRange(begin, end, page);
+		}
+		return false;
+	}
+
+	/**
+	 * The reserved capacity, not only the size.
+	 */
+	template <class T>
+	bool lock(const std::vector<T> &vector)
+	{
+		return lock(vector.data(), vector.capacity() * sizeof(T));
+	}
+
+	/**
+	 * All pages of the allocation, which only belong to the vector.
+	 */
+	template <class T>
+	bool lock(const std::vector<T, RTTIntrospectionPageAllocator<T>> &vector)
+	{
+		return lock(vector.data(), vector.capacity() > 0 ? RTTIntrospectionPageAllocator<T>::allocationSize(vector.capacity()) : 0);
+	}
+
+	/**
+	 * Unlocks the pages locked by this instance, which are never part of a foreign allocation.
+	 */
+	void unlock()
+	{
+		for (const std::pair<uintptr_t, std::size_t> &region : regions)
+		{
+			munlock(reinterpret_cast<const void *>(region.first), region.second);
+		}
+		regions.clear();
+		locked = 0;
+		prefaulted = 0;
+		error = 0;
+	}
+
+	// bytes of the whole pages inside the ranges
+	std::size_t getLocked() const
+	{
+		return locked;
+	}
+
+	// bytes of all pages the ranges touch
+	std::size_t getPrefaulted() const
+	{
+		return prefaulted;
+	}
+
+	// errno of the last failed mlock, 0 if all succeeded
+	int getError() const
+	{
+		return error;
+	}
+
+  private:
+	static void prefaultRange(const uintptr_t begin, const uintptr_t end, const uintptr_t page)
+	{
+		for (uintptr_t address = begin; address < end; address = (address & ~(page - 1)) + page)
+		{
+			// a write fault, a read would only map the shared zero page
+			volatile char *p = reinterpret_cast<volatile char *>(address);
+			*p = *p;
+		}
+	}
+
+	std::vector<std::pair<uintptr_t, std::size_t>> regions;
+	std::size_t locked;
+	std::size_t prefaulted;
+	int error;
+};
+
+} // namespace cogimon
+#endif
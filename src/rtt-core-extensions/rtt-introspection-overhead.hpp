@@ -0,0 +1,150 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_OVERHEAD_HPP
+#define RTT_INTROSPECTION_OVERHEAD_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+
+#include <Eigen/Core>
+
+#include "rtt-introspection-clock.hpp"
+
+namespace cogimon
+{
+
+/**
+ * Cost of the tracing itself, in raw trace_clock ticks.
+ * Calibrated in configureHook and then followed by an exponential moving average of the live measurements.
+ * The update methods are real-time safe and may only be called by one thread, the getters by any thread.
+ *
+ * A traced interval (hook or TraceScope) that contains n events, m of them intervals, is biased by about
+ * n * (timestamp + store) + m * timestamp + timestamp + n / events_per_flush * flush.
+ */
+class RTTIntrospectionOverheadModel
+{
+  public:
+	// layout of the vector of toNSecs()
+	enum ModelIndex
+	{
+		MODEL_TIMESTAMP = 0,
+		MODEL_STORE = 1,
+		MODEL_FLUSH = 2,
+		MODEL_EVENTS_PER_FLUSH = 3,
+		MODEL_SIZE = 4
+	};
+
+	// weight of a new measurement in the moving average
+	static constexpr double LIVE_WEIGHT = 1.0 / 64.0;
+
+	RTTIntrospectionOverheadModel() : timestamp(0), store(0), flush(0), events_per_flush(1)
+	{
+	}
+
+	void setCalibration(const double timestamp, const double store, const double flush, const std::size_t events_per_flush)
+	{
+		this->timestamp.store(timestamp, std::memory_order_relaxed);
+		this->store.store(store, std::memory_order_relaxed);
+		this->flush.store(flush, std::memory_order_relaxed);
+		setEventsPerFlush(events_per_flush);
+	}
+
+	/**
+	 * Changes with the batch size, see RTTIntrospectionBatchTuner.
+	 */
+	inline void setEventsPerFlush(const std::size_t events_per_flush)
+	{
+		this->events_per_flush.store(events_per_flush > 0 ? events_per_flush : 1, std::memory_order_relaxed);
+	}
+
+	inline void updateTimestamp(const uint_least64_t measured)
+	{
+		update(timestamp, static_cast<double>(measured));
+	}
+
+	/**
+	 * measured includes one timestamp, which is subtracted here.
+	 */
+	inline void updateStore(const uint_least64_t measured)
+	{
+		const double value = static_cast<double>(measured) - timestamp.load(std::memory_order_relaxed);
+		update(store, value > 0 ? value : 0);
+	}
+
+	/**
+	 * measured includes one timestamp, which is subtracted here.
+	 */
+	inline void updateFlush(const uint_least64_t measured)
+	{
+		const double value = static_cast<double>(measured) - timestamp.load(std::memory_order_relaxed);
+		update(flush, value > 0 ? value : 0);
+	}
+
+	double getTimestamp() const
+	{
+		return timestamp.load(std::memory_order_relaxed);
+	}
+
+	double getStore() const
+	{
+		return store.load(std::memory_order_relaxed);
+	}
+
+	double getFlush() const
+	{
+		return flush.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Converts the model into ns, see ModelIndex. Not real-time safe.
+	 */
+	void toNSecs(const RTTIntrospectionClock &clock, Eigen::VectorXd &model) const
+	{
+		model.resize(MODEL_SIZE);
+		model(MODEL_TIMESTAMP) = getTimestamp() * clock.getNSecsPerTick();
+		model(MODEL_STORE) = getStore() * clock.getNSecsPerTick();
+		model(MODEL_FLUSH) = getFlush() * clock.getNSecsPerTick();
+		model(MODEL_EVENTS_PER_FLUSH) = events_per_flush.load(std::memory_order_relaxed);
+	}
+
+  private:
+	static inline void update(std::atomic<double> &value, const double measured)
+	{
+		const double current = value.load(std::memory_order_relaxed);
+		value.store(current + (measured - current) * LIVE_WEIGHT, std::memory_order_relaxed);
+	}
+
+	std::atomic<double> timestamp;
+	std::atomic<double> store;
+	std::atomic<double> flush;
+	std::atomic<std::size_t> events_per_flush;
+};
+
+} // namespace cogimon
+#endif
@@ -0,0 +1,247 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_PERF_HPP
+#define RTT_INTROSPECTION_PERF_HPP
+
+#include <stdint.h>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace cogimon
+{
+
+enum PerfCounter
+{
+	PERF_CONTEXT_SWITCHES = 0,
+	PERF_PAGE_FAULTS = 1,
+	// ns the thread was running
+	PERF_TASK_CLOCK = 2,
+	PERF_CYCLES = 3,
+	PERF_INSTRUCTIONS = 4,
+	PERF_LLC_MISSES = 5,
+	PERF_COUNTER_COUNT = 6
+};
+
+/**
+ * Counter deltas and CPUs of one updateHookInternal() call, sent on out_perf_counter_port.
+ * Without usePerfCounters no counter is valid, without useCpuTrace the CPUs are -1.
+ */
+struct CallTracePerfSample
+{
+	// ns, same as the call_time of the matching updateHook() call trace sample
+	uint64_t call_time;
+	// ns, wall time of updateHookInternal()
+	uint64_t call_duration;
+	uint64_t values[PERF_COUNTER_COUNT];
+	uint16_t component_id;
+	// RTTIntrospectionPerfCounters::Source
+	uint8_t source;
+	// bit i is set if values[i] is measured
+	uint8_t valid;
+	// sched_getcpu() before and after updateHookInternal()
+	int16_t cpu_start;
+	int16_t cpu_end;
+	// cycles this sample stands for, see RTTIntrospectionSampler
+	uint32_t sampling_factor;
+};
+
+/**
+ * Counters of the calling thread, from perf_event_open if permitted, otherwise from getrusage(RUSAGE_THREAD)
+ * (context switches, page faults and task clock only).
+ * open() has to be called by the thread that is measured, read() is real-time safe apart from the system call.
+ */
+class RTTIntrospectionPerfCounters
+{
+  public:
+	enum Source
+	{
+		SOURCE_NONE = 0,
+		SOURCE_PERF_EVENT = 1,
+		SOURCE_RUSAGE = 2
+	};
+
+	RTTIntrospectionPerfCounters() : source(SOURCE_NONE), group_fd(-1), valid(0), group_size(0)
+	{
+		for (unsigned int i = 0; i < PERF_COUNTER_COUNT; i++)
+		{
+			fds[i] = -1;
+			slots[i] = -1;
+		}
+	}
+
+	~RTTIntrospectionPerfCounters()
+	{
+		close();
+	}
+
+	Source open()
+	{
+		close();
+#ifdef __linux__
+		static const uint32_t types[PERF_COUNTER_COUNT] = {PERF_TYPE_SOFTWARE, PERF_TYPE_SOFTWARE, PERF_TYPE_SOFTWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE};
+		static const uint64_t configs[PERF_COUNTER_COUNT] = {PERF_COUNT_SW_CONTEXT_SWITCHES, PERF_COUNT_SW_PAGE_FAULTS, PERF_COUNT_SW_TASK_CLOCK, PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+		// the task clock leads the group, so that the software counters work without a PMU (e.g. in VMs).
+		// Unprivileged users may only count user space (perf_event_paranoid), so retry without the kernel.
+		const unsigned int order[PERF_COUNTER_COUNT] = {PERF_TASK_CLOCK, PERF_CONTEXT_SWITCHES, PERF_PAGE_FAULTS, PERF_CYCLES, PERF_INSTRUCTIONS, PERF_LLC_MISSES};
+		for (int exclude_kernel = 0; exclude_kernel <= 1 && group_fd < 0; exclude_kernel++)
+		{
+			for (unsigned int i = 0; i < PERF_COUNTER_COUNT; i++)
+			{
+				const unsigned int counter = order[i];
+				perf_event_attr attr;
+				std::memset(&attr, 0, sizeof(attr));
+				attr.size = sizeof(attr);
+				attr.type = types[counter];
+				attr.config = configs[counter];
+				attr.read_format = PERF_FORMAT_GROUP;
+				attr.disabled = group_fd < 0 ? 1 : 0;
+				attr.exclude_kernel = exclude_kernel;
+				attr.exclude_hv = 1;
+				const int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0));
+				if (fd < 0)
+				{
+					if (group_fd < 0)
+					{
+						break;
+					}
+					continue;
+				}
+				if (group_fd < 0)
+				{
+					group_fd = fd;
+				}
+				fds[counter] = fd;
+				slots[counter] = group_size++;
+				valid |= 1 << counter;
+			}
+		}
+		if (group_fd >= 0)
+		{
+			ioctl(group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+			ioctl(group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+			source = SOURCE_PERF_EVENT;
+			return source;
+		}
+		rusage usage;
+		if (getrusage(RUSAGE_THREAD, &usage) == 0)
+		{
+			valid = (1 << PERF_CONTEXT_SWITCHES) | (1 << PERF_PAGE_FAULTS) | (1 << PERF_TASK_CLOCK);
+			source = SOURCE_RUSAGE;
+		}
+#endif
+		return source;
+	}
+
+	void close()
+	{
+#ifdef __linux__
+		for (unsigned int i = 0; i < PERF_COUNTER_COUNT; i++)
+		{
+			if (fds[i] >= 0)
+			{
+				::close(fds[i]);
+			}
+			fds[i] = -1;
+			slots[i] = -1;
+		}
+#endif
+		group_fd = -1;
+		group_size = 0;
+		valid = 0;
+		source = SOURCE_NONE;
+	}
+
+	/**
+	 * Current (absolute) values, the counters that are not valid are 0.
+	 */
+	inline bool read(uint64_t values[PERF_COUNTER_COUNT]) const
+	{
+		std::memset(values, 0, sizeof(uint64_t) * PERF_COUNTER_COUNT);
+#ifdef __linux__
+		if (source == SOURCE_PERF_EVENT)
+		{
+			// PERF_FORMAT_GROUP: number of counters followed by their values
+			uint64_t group[1 + PERF_COUNTER_COUNT];
+			if (::read(group_fd, group, sizeof(group)) < static_cast<ssize_t>(sizeof(uint64_t) * (1 + group_size)))
+			{
+				return false;
+			}
+			for (unsigned int i = 0; i < PERF_COUNTER_COUNT; i++)
+			{
+				if (slots[i] >= 0)
+				{
+					values[i] = group[1 + slots[i]];
+				}
+			}
+			return true;
+		}
+		if (source == SOURCE_RUSAGE)
+		{
+			rusage usage;
+			if (getrusage(RUSAGE_THREAD, &usage) != 0)
+			{
+				return false;
+			}
+			values[PERF_CONTEXT_SWITCHES] = usage.ru_nvcsw + usage.ru_nivcsw;
+			values[PERF_PAGE_FAULTS] = usage.ru_minflt + usage.ru_majflt;
+			values[PERF_TASK_CLOCK] = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ULL + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ULL;
+			return true;
+		}
+#endif
+		return false;
+	}
+
+	Source getSource() const
+	{
+		return source;
+	}
+
+	uint8_t getValid() const
+	{
+		return valid;
+	}
+
+  private:
+	Source source;
+	int fds[PERF_COUNTER_COUNT];
+	// position of the counter in the group read, -1 if not available
+	int slots[PERF_COUNTER_COUNT];
+	int group_fd;
+	uint8_t valid;
+	int group_size;
+};
+
+} // namespace cogimon
+#endif
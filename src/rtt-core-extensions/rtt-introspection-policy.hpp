@@ -0,0 +1,189 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_POLICY_HPP
+#define RTT_INTROSPECTION_POLICY_HPP
+
+#include "rtt-introspection-base.hpp"
+
+namespace cogimon
+{
+
+/**
+ * Tracing policies for RTTIntrospectionTaskContext.
+ * CallTracingEnabled is the RTTIntrospectionBase, which can still be toggled at runtime.
+ * CallTracingDisabled compiles all tracing out, the hooks and port accesses are forwarded directly.
+ */
+struct CallTracingEnabled
+{
+};
+
+struct CallTracingDisabled
+{
+};
+
+#ifdef RTT_INTROSPECTION_DISABLE_CALL_TRACING
+typedef CallTracingDisabled DefaultCallTracingPolicy;
+#else
+typedef CallTracingEnabled DefaultCallTracingPolicy;
+#endif
+
+/**
+ * Write the component once against RTTIntrospectionTaskContext<TracingPolicy>
+ * and instantiate it with both policies to get a traced and an untraced variant.
+ */
+template <class TracingPolicy>
+class RTTIntrospectionTaskContext;
+
+template <>
+class RTTIntrospectionTaskContext<CallTracingEnabled> : public RTTIntrospectionBase
+{
+  public:
+	RTTIntrospectionTaskContext(std::string const &name) : RTTIntrospectionBase(name)
+	{
+	}
+};
+
+template <>
+class RTTIntrospectionTaskContext<CallTracingDisabled> : public RTT::TaskContext
+{
+  public:
+	RTTIntrospectionTaskContext(std::string const &name) : RTT::TaskContext(name)
+	{
+	}
+
+	bool configureHook()
+	{
+		return configureHookInternal();
+	}
+
+	bool startHook()
+	{
+		return startHookInternal();
+	}
+
+	void updateHook()
+	{
+		updateHookInternal();
+	}
+
+	void stopHook()
+	{
+		stopHookInternal();
+	}
+
+	void cleanupHook()
+	{
+		cleanupHookInternal();
+	}
+
+	template <class PortT, class SampleT>
+	RTT::FlowStatus readPort(PortT &&input_port, SampleT &&sample, bool copy_old_data = true)
+	{
+		return port(input_port).read(sample, copy_old_data);
+	}
+
+	template <class PortT, class T>
+	void writePort(PortT &&output_port, const T &sample)
+	{
+		port(output_port).write(sample);
+	}
+
+	void processCTS(rstrt::monitoring::CallTraceSample & /* cts */)
+	{
+	}
+
+	uint16_t registerCallName(const std::string & /* call_name */)
+	{
+		return RTTIntrospectionNameRegistry::UNREGISTERED_ID;
+	}
+
+	template <class PortT>
+	PortTraceHandle<PortT> registerTracedPort(PortT &p)
+	{
+		return PortTraceHandle<PortT>(&p, RTTIntrospectionNameRegistry::UNREGISTERED_ID);
+	}
+
+	void beginTraceScope(const uint16_t /* call_name_id */)
+	{
+	}
+
+	void endTraceScope()
+	{
+	}
+
+	TraceScope<RTTIntrospectionTaskContext> traceScope(const uint16_t call_name_id)
+	{
+		return TraceScope<RTTIntrospectionTaskContext>(*this, call_name_id);
+	}
+
+  private:
+	template <class T>
+	static RTT::InputPort<T> &port(RTT::InputPort<T> &p)
+	{
+		return p;
+	}
+
+	template <class T>
+	static RTT::OutputPort<T> &port(RTT::OutputPort<T> &p)
+	{
+		return p;
+	}
+
+	template <class PortT>
+	static PortT &port(const PortTraceHandle<PortT> &h)
+	{
+		return *h.port;
+	}
+
+	template <class T>
+	static T &port(T *p)
+	{
+		return *p;
+	}
+
+	template <class T>
+	static T &port(const boost::shared_ptr<T> &p)
+	{
+		return *p;
+	}
+
+	template <class T>
+	static T &port(const std::shared_ptr<T> &p)
+	{
+		return *p;
+	}
+
+	virtual bool configureHookInternal() = 0;
+	virtual bool startHookInternal() = 0;
+	virtual void updateHookInternal() = 0;
+	virtual void stopHookInternal() = 0;
+	virtual void cleanupHookInternal() = 0;
+};
+
+} // namespace cogimon
+#endif
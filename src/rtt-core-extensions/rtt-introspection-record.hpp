@@ -0,0 +1,90 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_RECORD_HPP
+#define RTT_INTROSPECTION_RECORD_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "rtt-introspection-wire.hpp"
+#include "rtt-introspection-trace.hpp"
+#include "rtt-introspection-clock.hpp"
+
+// RST-RT includes
+#include <rst-rt/monitoring/CallTraceSample.hpp>
+
+namespace cogimon
+{
+
+/**
+ * Converts an event with raw timestamps of the given clock.
+ */
+inline CallTraceRecord toCallTraceRecord(const CallTraceEvent &cte, const RTTIntrospectionClock &clock, const uint16_t component_id)
+{
+	CallTraceRecord record;
+	record.call_time = clock.toNSecs(cte.call_time);
+	record.call_duration = 0;
+	record.sampling_factor = cte.sampling_factor;
+	record.call_name_id = cte.call_name_id;
+	record.component_id = component_id;
+	record.call_type = cte.call_type;
+	record.flags = 0;
+	record.depth = cte.depth;
+	record.reserved = 0;
+	if (cte.call_duration > cte.call_time)
+	{
+		const uint_least64_t duration = clock.durationToNSecs(cte.call_duration - cte.call_time);
+		if (duration > UINT32_MAX)
+		{
+			record.call_duration = UINT32_MAX;
+			record.flags |= CallTraceRecord::FLAG_DURATION_SATURATED;
+		}
+		else
+		{
+			record.call_duration = static_cast<uint32_t>(duration);
+		}
+	}
+	return record;
+}
+
+/**
+ * Converts a record back into the legacy sample, call_duration then again holds the absolute end time.
+ */
+inline void toCallTraceSample(const CallTraceRecord &record, const std::vector<std::string> &call_names, rstrt::monitoring::CallTraceSample &cts)
+{
+	static const std::string unregistered("<unregistered>");
+	cts.call_name = record.call_name_id < call_names.size() ? call_names[record.call_name_id] : unregistered;
+	cts.container_name = call_names.empty() ? unregistered : call_names[RTTIntrospectionNameRegistry::CONTAINER_ID];
+	cts.call_time = record.call_time;
+	cts.call_duration = record.call_duration > 0 ? record.call_time + record.call_duration : 0;
+	cts.call_type = static_cast<rstrt::monitoring::CallTraceSample::CallType>(record.call_type);
+}
+
+} // namespace cogimon
+#endif
@@ -0,0 +1,138 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_RING_HPP
+#define RTT_INTROSPECTION_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "rtt-introspection-memory.hpp"
+
+namespace cogimon
+{
+
+/**
+ * Lock-free single-producer single-consumer ring buffer.
+ *
+ * All slots are allocated in resize() (not real-time safe) and then only
+ * assigned to, so push() is a bounded store without any allocation as long
+ * as the element type does not need to grow (e.g. strings that fit into the
+ * capacity of the prototype).
+ * Exactly one thread may call push() and exactly one other thread may call
+ * front()/pop().
+ */
+template <class T>
+class RTTIntrospectionRing
+{
+  public:
+	RTTIntrospectionRing() : mask(0), head(0), tail(0)
+	{
+	}
+
+	/**
+	 * (Re-)allocate the ring. The capacity is rounded up to the next power of two.
+	 * Must not be called while a producer or consumer is active.
+	 */
+	void resize(const std::size_t capacity, const T &prototype)
+	{
+		std::size_t size = 1;
+		while (size < capacity)
+		{
+			size <<= 1;
+		}
+		slots.assign(size, prototype);
+		mask = size - 1;
+		head.store(0, std::memory_order_relaxed);
+		tail.store(0, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Producer side. Returns false and drops the element if the ring is full.
+	 */
+	bool push(const T &element)
+	{
+		const std::size_t h = head.load(std::memory_order_relaxed);
+		if (slots.empty() || h - tail.load(std::memory_order_acquire) > mask)
+		{
+			return false;
+		}
+		slots[h & mask] = element;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Consumer side. Returns the oldest element or 0 if the ring is empty.
+	 */
+	T *front()
+	{
+		const std::size_t t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire))
+		{
+			return 0;
+		}
+		return &slots[t & mask];
+	}
+
+	/**
+	 * Consumer side. Releases the element returned by front().
+	 */
+	void pop()
+	{
+		tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	std::size_t size() const
+	{
+		return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+	}
+
+	std::size_t capacity() const
+	{
+		return slots.size();
+	}
+
+	// page-aligned, e.g. to lock them in memory
+	const std::vector<T, RTTIntrospectionPageAllocator<T>> &getSlots() const
+	{
+		return slots;
+	}
+
+  private:
+	std::vector<T, RTTIntrospectionPageAllocator<T>> slots;
+	std::size_t mask;
+	// keep producer and consumer indices on separate cache lines
+	char pad_head[64];
+	std::atomic<std::size_t> head;
+	char pad_tail[64];
+	std::atomic<std::size_t> tail;
+};
+
+} // namespace cogimon
+#endif
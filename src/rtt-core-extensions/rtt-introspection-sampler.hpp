@@ -0,0 +1,197 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_SAMPLER_HPP
+#define RTT_INTROSPECTION_SAMPLER_HPP
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+
+namespace cogimon
+{
+
+/**
+ * Decides per updateHook cycle whether the call trace events of that cycle are stored.
+ * All methods except configure() are real-time safe.
+ *
+ * The sampling factor is the number of cycles one traced cycle stands for,
+ * the analysis has to multiply the counts with it.
+ */
+class RTTIntrospectionSampler
+{
+  public:
+	enum SamplingMode
+	{
+		// trace every cycle
+		SAMPLING_FULL = 0,
+		// trace 1 of interval cycles
+		SAMPLING_INTERVAL = 1,
+		// trace a cycle with the given probability
+		SAMPLING_RANDOM = 2,
+		// adapt the interval, so that the stored events per second stay below the budget
+		SAMPLING_ADAPTIVE = 3
+	};
+
+	// largest number of cycles one traced cycle may stand for
+	static const uint32_t MAX_INTERVAL = 1000000;
+
+	RTTIntrospectionSampler() : mode(SAMPLING_FULL),
+								interval(10),
+								probability(0.1),
+								event_budget(1000.0),
+								factor(1),
+								random_interval(10),
+								random_probability(0.1),
+								adaptive_interval(1),
+								cycle_counter(0),
+								rng_state(0x9E3779B97F4A7C15ULL),
+								window_length(1),
+								window_start(0),
+								window_events_start(0)
+	{
+	}
+
+	/**
+	 * window_length: ticks (of the clock used for sampleCycle()) of one second, which is the adaptation window.
+	 * Takes over the probability, which is rounded to 1/N (N >= 1), so that the factor N is exact.
+	 * Returns false if the probability had to be rounded or clamped, it then holds the value that is used.
+	 */
+	bool configure(const uint_least64_t window_length)
+	{
+		this->window_length = window_length > 0 ? window_length : 1;
+		factor = 1;
+		adaptive_interval = 1;
+		cycle_counter = 0;
+		window_start = 0;
+		window_events_start = 0;
+
+		// NaN and probabilities <= 0 trace as rarely as possible
+		double n = static_cast<double>(MAX_INTERVAL);
+		if (probability >= 1.0)
+		{
+			n = 1.0;
+		}
+		else if (probability > 0.0)
+		{
+			n = std::min(std::floor(1.0 / probability + 0.5), static_cast<double>(MAX_INTERVAL));
+		}
+		random_interval = static_cast<uint32_t>(n);
+		random_probability = 1.0 / n;
+		const bool exact = probability == random_probability;
+		probability = random_probability;
+		return exact;
+	}
+
+	/**
+	 * now: current time in ticks, events_stored: number of events stored so far (used by the adaptive mode).
+	 */
+	inline bool sampleCycle(const uint_least64_t now, const uint_least64_t events_stored)
+	{
+		switch (mode)
+		{
+		case SAMPLING_INTERVAL:
+			factor = interval > 0 ? interval : 1;
+			return (cycle_counter++ % factor) == 0;
+		case SAMPLING_RANDOM:
+			factor = random_interval;
+			return static_cast<double>(nextRandom() >> 11) * (1.0 / 9007199254740992.0) < random_probability;
+		case SAMPLING_ADAPTIVE:
+			adapt(now, events_stored);
+			factor = adaptive_interval;
+			return (cycle_counter++ % factor) == 0;
+		default:
+			factor = 1;
+			return true;
+		}
+	}
+
+	inline uint32_t getFactor() const
+	{
+		return factor;
+	}
+
+	// properties
+	int mode;
+	unsigned int interval;
+	// taken over by configure()
+	double probability;
+	// events per second
+	double event_budget;
+
+  private:
+	inline void adapt(const uint_least64_t now, const uint_least64_t events_stored)
+	{
+		if (window_start == 0)
+		{
+			window_start = now;
+			window_events_start = events_stored;
+			return;
+		}
+		if (now - window_start < window_length)
+		{
+			return;
+		}
+		// scale the stored events back to the rate without sampling
+		const double window_seconds = static_cast<double>(now - window_start) / static_cast<double>(window_length);
+		const double full_rate = static_cast<double>(events_stored - window_events_start) * adaptive_interval / window_seconds;
+		double next = event_budget > 0 ? std::ceil(full_rate / event_budget) : 1.0;
+		if (next < 1.0)
+		{
+			next = 1.0;
+		}
+		else if (next > static_cast<double>(MAX_INTERVAL))
+		{
+			next = static_cast<double>(MAX_INTERVAL);
+		}
+		adaptive_interval = static_cast<uint32_t>(next);
+		window_start = now;
+		window_events_start = events_stored;
+	}
+
+	// xorshift64*
+	inline uint_least64_t nextRandom()
+	{
+		rng_state ^= rng_state >> 12;
+		rng_state ^= rng_state << 25;
+		rng_state ^= rng_state >> 27;
+		return rng_state * 2685821657736338717ULL;
+	}
+
+	uint32_t factor;
+	uint32_t random_interval;
+	double random_probability;
+	uint32_t adaptive_interval;
+	uint_least64_t cycle_counter;
+	uint_least64_t rng_state;
+	uint_least64_t window_length;
+	uint_least64_t window_start;
+	uint_least64_t window_events_start;
+};
+
+} // namespace cogimon
+#endif
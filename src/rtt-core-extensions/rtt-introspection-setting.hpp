@@ -0,0 +1,85 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_SETTING_HPP
+#define RTT_INTROSPECTION_SETTING_HPP
+
+#include <functional>
+
+#include <rtt/internal/DataSources.hpp>
+
+namespace cogimon
+{
+
+/**
+ * Data source of a property that the real-time thread must not read directly. Every assignment (from a script,
+ * the deployer or a property file) is passed to apply, which hands it over (see RTTIntrospectionHandover), instead
+ * of being written into the member the real-time thread uses.
+ * The property shows the last requested value, mirror() keeps it in sync with operations that change the same setting.
+ */
+template <class T>
+class RTTIntrospectionSettingDataSource : public RTT::internal::ValueDataSource<T>
+{
+  public:
+	typedef boost::intrusive_ptr<RTTIntrospectionSettingDataSource<T>> shared_ptr;
+
+	RTTIntrospectionSettingDataSource(const T &value, const std::function<void(const T &)> &apply) : RTT::internal::ValueDataSource<T>(value),
+																								   apply(apply)
+	{
+	}
+
+	using RTT::internal::ValueDataSource<T>::set;
+
+	void set(typename RTT::internal::AssignableDataSource<T>::param_t t)
+	{
+		this->mdata = t;
+		apply(this->mdata);
+	}
+
+	// after a write through the reference returned by set()
+	void updated()
+	{
+		apply(this->mdata);
+	}
+
+	// records a change that was requested otherwise, without applying it again
+	void mirror(const T &t)
+	{
+		this->mdata = t;
+	}
+
+	RTTIntrospectionSettingDataSource<T> *clone() const
+	{
+		return new RTTIntrospectionSettingDataSource<T>(this->mdata, apply);
+	}
+
+  private:
+	std::function<void(const T &)> apply;
+};
+
+} // namespace cogimon
+#endif
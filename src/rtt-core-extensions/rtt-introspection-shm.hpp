@@ -0,0 +1,374 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_SHM_HPP
+#define RTT_INTROSPECTION_SHM_HPP
+
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "rtt-introspection-wire.hpp"
+
+// Only depends on the standard library and POSIX, so that the collector does not need RTT.
+
+namespace cogimon
+{
+
+/**
+ * Layout of a call trace ring in POSIX shared memory (/dev/shm/rtt-introspection.<pid>.<container name>), version 1:
+ *
+ *   offset 0                  CallTraceShmHeader (256 bytes)
+ *   offset names_offset       call name table: names_size bytes of '\0' terminated names, the index is the call_name_id
+ *   offset records_offset     capacity CallTraceRecords (record_size bytes each), capacity is a power of two
+ *
+ * write_index and read_index count records since creation, record i is at slot i & (capacity - 1).
+ * The producer only writes records and write_index, the collector only read_index (and collector_pid).
+ * If the collector falls behind, new records are dropped and counted in dropped, the producer never waits.
+ * The magic is written last, a collector must not use a ring before the magic is valid.
+ */
+struct CallTraceShmHeader
+{
+	static const uint32_t VERSION = 1;
+
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t record_size;
+	uint32_t capacity;
+	uint32_t names_offset;
+	uint32_t names_size;
+	uint32_t records_offset;
+	uint32_t component_id;
+	uint32_t pid;
+	uint32_t reserved;
+	// RTT::os::TimeService ns of the creation, changes with every configureHook
+	uint64_t create_time;
+	char container_name[64];
+	char padding0[8];
+
+	// own cache lines for the producer and the collector
+	std::atomic<uint64_t> write_index;
+	std::atomic<uint64_t> dropped;
+	char padding1[48];
+	std::atomic<uint64_t> read_index;
+	std::atomic<uint32_t> collector_pid;
+	char padding2[52];
+};
+
+static_assert(sizeof(CallTraceShmHeader) == 256, "CallTraceShmHeader is part of the shared memory layout");
+static_assert(offsetof(CallTraceShmHeader, write_index) == 128, "CallTraceShmHeader is part of the shared memory layout");
+static_assert(offsetof(CallTraceShmHeader, read_index) == 192, "CallTraceShmHeader is part of the shared memory layout");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the shared memory ring needs address-free 64 bit atomics");
+
+static const char RTT_INTROSPECTION_SHM_MAGIC[8] = {'R', 'T', 'T', 'I', 'S', 'H', 'M', '\0'};
+// prefix of the shared memory objects, the collector attaches to all of them
+static const char *const RTT_INTROSPECTION_SHM_PREFIX = "rtt-introspection.";
+
+/**
+ * One shared memory ring, used by the producing component (create) and by the collector (attach).
+ */
+class RTTIntrospectionShmRing
+{
+  public:
+	RTTIntrospectionShmRing() : header(0), names(0), records(0), mapped_size(0), owner(false)
+	{
+	}
+
+	~RTTIntrospectionShmRing()
+	{
+		close();
+	}
+
+	/**
+	 * Shared memory object name of a container in the process pid, '/' and other characters are replaced.
+	 * The pid keeps equally named containers of different processes from replacing each other's rings.
+	 */
+	static std::string objectName(const std::string &container_name, const uint32_t pid)
+	{
+		std::string name = std::string("/") + RTT_INTROSPECTION_SHM_PREFIX + std::to_string(pid) + ".";
+		for (char c : container_name)
+		{
+			name += (std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-' || c == '.') ? c : '_';
+		}
+		return name;
+	}
+
+	/**
+	 * Producer: (re)creates the ring with at least capacity records and the name table. Not real-time safe.
+	 */
+	bool create(const std::string &container_name, const uint32_t component_id, const std::vector<std::string> &call_names, const std::size_t capacity, const uint64_t create_time)
+	{
+		close();
+		std::size_t slots = 1;
+		while (slots < capacity)
+		{
+			slots <<= 1;
+		}
+		std::size_t names_size = 0;
+		for (const std::string &call_name : call_names)
+		{
+			names_size += call_name.size() + 1;
+		}
+		const std::size_t names_offset = sizeof(CallTraceShmHeader);
+		const std::size_t records_offset = (names_offset + names_size + 63) & ~static_cast<std::size_t>(63);
+		const std::size_t size = records_offset + slots * sizeof(CallTraceRecord);
+
+		name = objectName(container_name, static_cast<uint32_t>(getpid()));
+		// only a ring of this process (or of a dead one with the same pid) is replaced,
+		// a collector that still maps the old object keeps it until it notices the new one
+		shm_unlink(name.c_str());
+		const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+		if (fd < 0)
+		{
+			return false;
+		}
+		if (ftruncate(fd, size) != 0 || !map(fd, size))
+		{
+			::close(fd);
+			shm_unlink(name.c_str());
+			return false;
+		}
+		::close(fd);
+		owner = true;
+
+		header = new (header) CallTraceShmHeader();
+		header->version = CallTraceShmHeader::VERSION;
+		header->header_size = sizeof(CallTraceShmHeader);
+		header->record_size = sizeof(CallTraceRecord);
+		header->capacity = static_cast<uint32_t>(slots);
+		header->names_offset = static_cast<uint32_t>(names_offset);
+		header->names_size = static_cast<uint32_t>(names_size);
+		header->records_offset = static_cast<uint32_t>(records_offset);
+		header->component_id = component_id;
+		header->pid = static_cast<uint32_t>(getpid());
+		header->create_time = create_time;
+		std::strncpy(header->container_name, container_name.c_str(), sizeof(header->container_name) - 1);
+		header->write_index.store(0, std::memory_order_relaxed);
+		header->dropped.store(0, std::memory_order_relaxed);
+		header->read_index.store(0, std::memory_order_relaxed);
+		header->collector_pid.store(0, std::memory_order_relaxed);
+		names = reinterpret_cast<char *>(header) + names_offset;
+		records = reinterpret_cast<CallTraceRecord *>(reinterpret_cast<char *>(header) + records_offset);
+		char *next = names;
+		for (const std::string &call_name : call_names)
+		{
+			std::memcpy(next, call_name.c_str(), call_name.size() + 1);
+			next += call_name.size() + 1;
+		}
+		std::atomic_thread_fence(std::memory_order_release);
+		std::memcpy(header->magic, RTT_INTROSPECTION_SHM_MAGIC, sizeof(header->magic));
+		return true;
+	}
+
+	/**
+	 * Collector: maps an existing ring (name as returned by objectName()) and registers as its collector.
+	 */
+	bool attach(const std::string &object_name)
+	{
+		close();
+		const int fd = shm_open(object_name.c_str(), O_RDWR, 0);
+		if (fd < 0)
+		{
+			return false;
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(CallTraceShmHeader) || !map(fd, st.st_size))
+		{
+			::close(fd);
+			return false;
+		}
+		::close(fd);
+		if (std::memcmp(header->magic, RTT_INTROSPECTION_SHM_MAGIC, sizeof(header->magic)) != 0 || header->version != CallTraceShmHeader::VERSION || header->record_size != sizeof(CallTraceRecord) ||
+			header->capacity == 0 || (header->capacity & (header->capacity - 1)) != 0 ||
+			static_cast<std::size_t>(header->records_offset) + static_cast<std::size_t>(header->capacity) * sizeof(CallTraceRecord) > mapped_size ||
+			static_cast<std::size_t>(header->names_offset) + header->names_size > header->records_offset)
+		{
+			close();
+			return false;
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		name = object_name;
+		names = reinterpret_cast<char *>(header) + header->names_offset;
+		records = reinterpret_cast<CallTraceRecord *>(reinterpret_cast<char *>(header) + header->records_offset);
+		header->collector_pid.store(static_cast<uint32_t>(getpid()), std::memory_order_relaxed);
+		return true;
+	}
+
+	/**
+	 * Unmaps the ring, the producer also removes the shared memory object.
+	 */
+	void close()
+	{
+		if (!header)
+		{
+			return;
+		}
+		if (!owner)
+		{
+			header->collector_pid.store(0, std::memory_order_relaxed);
+		}
+		munmap(header, mapped_size);
+		if (owner)
+		{
+			shm_unlink(name.c_str());
+		}
+		header = 0;
+		names = 0;
+		records = 0;
+		mapped_size = 0;
+		owner = false;
+	}
+
+	bool isOpen() const
+	{
+		return header != 0;
+	}
+
+	/**
+	 * Producer: copies as many records as fit, the rest is counted as dropped. Returns the number written. Never blocks.
+	 */
+	std::size_t write(const CallTraceRecord *data, const std::size_t count)
+	{
+		const uint64_t write_index = header->write_index.load(std::memory_order_relaxed);
+		const uint64_t free = header->capacity - (write_index - header->read_index.load(std::memory_order_acquire));
+		const std::size_t written = count < free ? count : static_cast<std::size_t>(free);
+		const uint64_t mask = header->capacity - 1;
+		for (std::size_t i = 0; i < written; i++)
+		{
+			records[(write_index + i) & mask] = data[i];
+		}
+		header->write_index.store(write_index + written, std::memory_order_release);
+		if (written < count)
+		{
+			header->dropped.store(header->dropped.load(std::memory_order_relaxed) + count - written, std::memory_order_relaxed);
+		}
+		return written;
+	}
+
+	/**
+	 * Collector: appends all available records to out and returns their number.
+	 */
+	std::size_t read(std::vector<CallTraceRecord> &out)
+	{
+		const uint64_t read_index = header->read_index.load(std::memory_order_relaxed);
+		const uint64_t write_index = header->write_index.load(std::memory_order_acquire);
+		const uint64_t mask = header->capacity - 1;
+		for (uint64_t i = read_index; i != write_index; i++)
+		{
+			out.push_back(records[i & mask]);
+		}
+		header->read_index.store(write_index, std::memory_order_release);
+		return static_cast<std::size_t>(write_index - read_index);
+	}
+
+	/**
+	 * Records that the collector has not read yet.
+	 */
+	uint64_t pending() const
+	{
+		return header->write_index.load(std::memory_order_acquire) - header->read_index.load(std::memory_order_acquire);
+	}
+
+	bool hasCollector() const
+	{
+		return header->collector_pid.load(std::memory_order_relaxed) != 0;
+	}
+
+	uint64_t getDropped() const
+	{
+		return header->dropped.load(std::memory_order_relaxed);
+	}
+
+	const CallTraceShmHeader &getHeader() const
+	{
+		return *header;
+	}
+
+	// bytes mapped from &getHeader()
+	std::size_t getMappedSize() const
+	{
+		return mapped_size;
+	}
+
+	/**
+	 * The call name table, the index is the call_name_id.
+	 */
+	std::vector<std::string> getNames() const
+	{
+		std::vector<std::string> table;
+		const char *next = names;
+		const char *end = names + header->names_size;
+		while (next < end)
+		{
+			const std::size_t length = strnlen(next, end - next);
+			table.push_back(std::string(next, length));
+			next += length + 1;
+		}
+		return table;
+	}
+
+	const std::string &getName() const
+	{
+		return name;
+	}
+
+  private:
+	bool map(const int fd, const std::size_t size)
+	{
+		void *address = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (address == MAP_FAILED)
+		{
+			return false;
+		}
+		header = static_cast<CallTraceShmHeader *>(address);
+		mapped_size = size;
+		return true;
+	}
+
+	RTTIntrospectionShmRing(const RTTIntrospectionShmRing &);
+	RTTIntrospectionShmRing &operator=(const RTTIntrospectionShmRing &);
+
+	CallTraceShmHeader *header;
+	char *names;
+	CallTraceRecord *records;
+	std::size_t mapped_size;
+	bool owner;
+	std::string name;
+};
+
+} // namespace cogimon
+#endif
@@ -0,0 +1,230 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_SUMMARY_HPP
+#define RTT_INTROSPECTION_SUMMARY_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "rtt-introspection-trace.hpp"
+#include <rst-rt/monitoring/CallTraceSample.hpp>
+
+namespace cogimon
+{
+
+/**
+ * Aggregate of one call name (port, hook or TraceScope) over one summary interval, sent on out_call_trace_summary_port.
+ * The counts are weighted with the sampling factor. Durations are only counted for CALL_START_WITH_DURATION events.
+ */
+struct CallTraceSummaryRecord
+{
+	// ns
+	uint64_t start_time;
+	uint64_t end_time;
+	uint64_t calls;
+	uint64_t reads_new_data;
+	uint64_t reads_old_data;
+	uint64_t reads_no_data;
+	uint64_t writes;
+	// ns, mean = duration_sum / durations
+	uint64_t durations;
+	uint64_t duration_sum;
+	uint64_t duration_min;
+	uint64_t duration_max;
+	uint16_t component_id;
+	uint16_t call_name_id;
+	uint32_t reserved;
+};
+
+/**
+ * Counters per call name id in place of the raw events (summary mode).
+ *
+ * There are two banks: the real-time thread adds to the active one and swaps them in rotate() once the interval has
+ * passed, but only if the drain thread has emptied the other bank in consume(). Otherwise the interval is extended,
+ * so neither side ever waits and nothing is lost. All times are raw trace_clock ticks.
+ */
+class RTTIntrospectionSummary
+{
+  public:
+	RTTIntrospectionSummary() : active(0), ready(0), interval(0), next_rotation(0)
+	{
+	}
+
+	/**
+	 * Not real-time safe and only while neither thread uses the summary.
+	 */
+	void configure(const std::size_t ids, const uint_least64_t interval_ticks, const uint_least64_t now)
+	{
+		for (unsigned int b = 0; b < 2; b++)
+		{
+			banks[b].entries.assign(ids, Entry());
+			banks[b].start = now;
+			banks[b].end = now;
+		}
+		active = 0;
+		ready.store(0, std::memory_order_relaxed);
+		interval = interval_ticks;
+		next_rotation = now + interval;
+	}
+
+	/**
+	 * Real-time thread.
+	 */
+	inline void add(const CallTraceEvent &cte)
+	{
+		std::vector<Entry> &entries = banks[active].entries;
+		if (cte.call_name_id >= entries.size())
+		{
+			return;
+		}
+		Entry &entry = entries[cte.call_name_id];
+		const uint32_t weight = cte.sampling_factor > 0 ? cte.sampling_factor : 1;
+		entry.calls += weight;
+		switch (cte.call_type)
+		{
+		case rstrt::monitoring::CallTraceSample::CALL_PORT_READ_NEWDATA:
+			entry.reads_new_data += weight;
+			break;
+		case rstrt::monitoring::CallTraceSample::CALL_PORT_READ_OLDDATA:
+			entry.reads_old_data += weight;
+			break;
+		case rstrt::monitoring::CallTraceSample::CALL_PORT_READ_NODATA:
+			entry.reads_no_data += weight;
+			break;
+		case rstrt::monitoring::CallTraceSample::CALL_PORT_WRITE:
+			entry.writes += weight;
+			break;
+		case rstrt::monitoring::CallTraceSample::CALL_START_WITH_DURATION:
+		{
+			// call_duration holds the end time
+			const uint_least64_t duration = cte.call_duration > cte.call_time ? cte.call_duration - cte.call_time : 0;
+			entry.durations += weight;
+			entry.duration_sum += duration * weight;
+			if (entry.durations == weight || duration < entry.duration_min)
+			{
+				entry.duration_min = duration;
+			}
+			if (duration > entry.duration_max)
+			{
+				entry.duration_max = duration;
+			}
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	/**
+	 * Real-time thread: hands the active bank over to consume() once the interval has passed (or right away with force).
+	 * Returns false if it is not due yet or the drain thread is behind.
+	 */
+	inline bool rotate(const uint_least64_t now, const bool force = false)
+	{
+		if ((!force && now < next_rotation) || ready.load(std::memory_order_acquire) != 0)
+		{
+			return false;
+		}
+		banks[active].end = now;
+		const unsigned int handed_over = active;
+		active = 1 - active;
+		banks[active].start = now;
+		next_rotation = now + interval;
+		ready.store(handed_over + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Drain thread: calls f(call_name_id, entry, start, end) for each id with events in the handed over bank, then empties it.
+	 * Returns false if nothing was handed over.
+	 */
+	template <class F>
+	bool consume(F f)
+	{
+		const unsigned int handed_over = ready.load(std::memory_order_acquire);
+		if (handed_over == 0)
+		{
+			return false;
+		}
+		Bank &bank = banks[handed_over - 1];
+		for (std::size_t id = 0; id < bank.entries.size(); id++)
+		{
+			if (bank.entries[id].calls > 0)
+			{
+				f(static_cast<uint16_t>(id), bank.entries[id], bank.start, bank.end);
+				bank.entries[id] = Entry();
+			}
+		}
+		ready.store(0, std::memory_order_release);
+		return true;
+	}
+
+	struct Entry
+	{
+		Entry() : calls(0), reads_new_data(0), reads_old_data(0), reads_no_data(0), writes(0), durations(0), duration_sum(0), duration_min(0), duration_max(0)
+		{
+		}
+
+		uint64_t calls;
+		uint64_t reads_new_data;
+		uint64_t reads_old_data;
+		uint64_t reads_no_data;
+		uint64_t writes;
+		uint64_t durations;
+		// raw ticks
+		uint64_t duration_sum;
+		uint64_t duration_min;
+		uint64_t duration_max;
+	};
+
+	const std::vector<Entry> &getEntries(const unsigned int bank) const
+	{
+		return banks[bank].entries;
+	}
+
+  private:
+	struct Bank
+	{
+		std::vector<Entry> entries;
+		uint_least64_t start;
+		uint_least64_t end;
+	};
+
+	Bank banks[2];
+	// only accessed by the real-time thread
+	unsigned int active;
+	// 1 + index of the bank handed over to consume(), 0 if none
+	std::atomic<unsigned int> ready;
+	uint_least64_t interval;
+	uint_least64_t next_rotation;
+};
+
+} // namespace cogimon
+#endif
@@ -0,0 +1,203 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_TRACE_HPP
+#define RTT_INTROSPECTION_TRACE_HPP
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace cogimon
+{
+
+/**
+ * Names of the samples that are no calls of the component: the marker that carries the sampling factor of the
+ * following samples (in call_duration), the overrun of an updateHook (same interval as the updateHook)
+ * and the prefix of the trigger samples, "trigger(<port>)", whose interval is the latency from the port write to the updateHook.
+ * Consumers compare the names with these, so they must only be spelled here.
+ */
+static const char *const SAMPLING_FACTOR_NAME = "samplingFactor()";
+static const char *const DEADLINE_MISS_NAME = "deadlineMiss(updateHook())";
+static const char *const TRIGGER_NAME_PREFIX = "trigger(";
+
+/**
+ * Call trace sample as it is stored by the real-time thread.
+ * Only holds integers, the names are resolved with the RTTIntrospectionNameRegistry outside of the real-time thread.
+ * call_type holds a rstrt::monitoring::CallTraceSample::CallType.
+ * sampling_factor is the number of cycles this event stands for (see RTTIntrospectionSampler).
+ * depth is the nesting level of a TraceScope, 0 for the hooks and port accesses.
+ */
+struct CallTraceEvent
+{
+	CallTraceEvent() : call_time(0), call_duration(0), call_name_id(0), call_type(0), depth(0), sampling_factor(1)
+	{
+	}
+
+	uint_least64_t call_time;
+	uint_least64_t call_duration;
+	uint16_t call_name_id;
+	uint8_t call_type;
+	uint8_t depth;
+	uint32_t sampling_factor;
+};
+
+struct RTTIntrospectionCausalPort;
+
+/**
+ * Precomputed tracing information of a port, see RTTIntrospectionBase::registerTracedPort.
+ * cte is the sample template with the name id already set, only time and type are filled per access.
+ * Whether the port is traced is decided by the trace mask of the component (see setTraceEnabled).
+ * causal is the causal tracing state of the port, owned by the component, 0 if the port has none.
+ */
+template <class PortT>
+struct PortTraceHandle
+{
+	PortTraceHandle() : port(0), causal(0)
+	{
+	}
+
+	PortTraceHandle(PortT *port, const uint16_t call_name_id, const RTTIntrospectionCausalPort *causal = 0) : port(port), causal(causal)
+	{
+		cte.call_name_id = call_name_id;
+	}
+
+	PortT *port;
+	const RTTIntrospectionCausalPort *causal;
+	CallTraceEvent cte;
+};
+
+/**
+ * Times a named sub-phase, e.g. of updateHookInternal(), from construction to destruction.
+ * Scopes can be nested, the reporter reconstructs the call tree from them.
+ * ContextT provides beginTraceScope(id) and endTraceScope(), use its traceScope(id) to create one:
+ *
+ *     const uint16_t solver_id = this->registerCallName("solver");  // in configureHookInternal()
+ *     ...
+ *     {
+ *         auto scope = this->traceScope(solver_id);
+ *         solve();
+ *     }
+ */
+template <class ContextT>
+class TraceScope
+{
+  public:
+	TraceScope(ContextT &context, const uint16_t call_name_id) : context(&context)
+	{
+		context.beginTraceScope(call_name_id);
+	}
+
+	TraceScope(TraceScope &&other) : context(other.context)
+	{
+		other.context = 0;
+	}
+
+	~TraceScope()
+	{
+		if (context)
+		{
+			context->endTraceScope();
+		}
+	}
+
+  private:
+	TraceScope(const TraceScope &);
+	TraceScope &operator=(const TraceScope &);
+
+	ContextT *context;
+};
+
+/**
+ * Maps the names of the hooks and ports of a component to small integer ids.
+ * Names are only added, so ids stay valid across reconfigurations.
+ * The registry must not be changed while the component is running.
+ * The index in getNames() is the id.
+ */
+class RTTIntrospectionNameRegistry
+{
+  public:
+	// reserved ids
+	static const uint16_t CONTAINER_ID = 0;
+	static const uint16_t UNREGISTERED_ID = 1;
+
+	void reset(const std::string &container_name)
+	{
+		names.clear();
+		ids.clear();
+		registerName(container_name);
+		registerName("<unregistered>");
+	}
+
+	uint16_t registerName(const std::string &name)
+	{
+		std::map<std::string, uint16_t>::const_iterator it = ids.find(name);
+		if (it != ids.end())
+		{
+			return it->second;
+		}
+		const uint16_t id = static_cast<uint16_t>(names.size());
+		names.push_back(name);
+		ids[name] = id;
+		return id;
+	}
+
+	/**
+	 * Does not allocate. Returns UNREGISTERED_ID if the name is unknown.
+	 */
+	uint16_t findName(const std::string &name) const
+	{
+		std::map<std::string, uint16_t>::const_iterator it = ids.find(name);
+		if (it != ids.end())
+		{
+			return it->second;
+		}
+		return UNREGISTERED_ID;
+	}
+
+	const std::string &getName(const uint16_t id) const
+	{
+		if (id < names.size())
+		{
+			return names[id];
+		}
+		return names[UNREGISTERED_ID];
+	}
+
+	const std::vector<std::string> &getNames() const
+	{
+		return names;
+	}
+
+  private:
+	std::vector<std::string> names;
+	std::map<std::string, uint16_t> ids;
+};
+
+} // namespace cogimon
+#endif
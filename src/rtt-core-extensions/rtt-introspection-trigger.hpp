@@ -0,0 +1,145 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_TRIGGER_HPP
+#define RTT_INTROSPECTION_TRIGGER_HPP
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace cogimon
+{
+
+/**
+ * Remembers which input ports woke an event-driven component up and when.
+ *
+ * The writing component calls mark() from its own thread (via dataOnPortHook) before the activity is triggered.
+ * Each slot keeps the time of the first write since the last collect(), later writes are coalesced into the same
+ * activation. The real-time thread of the component takes the slots back in collect() at the start of updateHook.
+ * The port list is fixed between assign() calls, mark() only reads it while the table is armed.
+ */
+class RTTIntrospectionTriggerTable
+{
+  public:
+	RTTIntrospectionTriggerTable() : armed(false), count(0)
+	{
+	}
+
+	/**
+	 * Not real-time safe and only while disarmed. The entries map a port to the call name id of its trigger event.
+	 */
+	void assign(std::vector<std::pair<const void *, uint16_t>> entries)
+	{
+		std::sort(entries.begin(), entries.end());
+		entries.erase(std::unique(entries.begin(), entries.end(), [](const std::pair<const void *, uint16_t> &a, const std::pair<const void *, uint16_t> &b) { return a.first == b.first; }), entries.end());
+		count = entries.size();
+		ports.resize(count);
+		slots.reset(count > 0 ? new Slot[count] : 0);
+		for (std::size_t i = 0; i < count; i++)
+		{
+			ports[i] = entries[i].first;
+			slots[i].call_name_id = entries[i].second;
+			slots[i].first_write.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	void arm(const bool enable)
+	{
+		armed.store(enable && count > 0, std::memory_order_release);
+	}
+
+	bool isArmed() const
+	{
+		return armed.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Any thread. Does not allocate, unknown ports are ignored.
+	 */
+	inline void mark(const void *port, const uint_least64_t now)
+	{
+		if (!armed.load(std::memory_order_acquire))
+		{
+			return;
+		}
+		const std::vector<const void *>::const_iterator it = std::lower_bound(ports.begin(), ports.end(), port);
+		if (it == ports.end() || *it != port)
+		{
+			return;
+		}
+		uint_least64_t expected = 0;
+		// 0 is reserved for an empty slot
+		slots[it - ports.begin()].first_write.compare_exchange_strong(expected, now > 0 ? now : 1, std::memory_order_release, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Real-time thread: calls f(call_name_id, first_write) for each port that was written up to start and empties its slot.
+	 * Writes after start are left for the next activation they trigger.
+	 */
+	template <class F>
+	inline void collect(const uint_least64_t start, F f)
+	{
+		for (std::size_t i = 0; i < count; i++)
+		{
+			uint_least64_t first_write = slots[i].first_write.load(std::memory_order_acquire);
+			if (first_write == 0 || first_write > start)
+			{
+				continue;
+			}
+			if (slots[i].first_write.compare_exchange_strong(first_write, 0, std::memory_order_acq_rel, std::memory_order_relaxed))
+			{
+				f(slots[i].call_name_id, first_write);
+			}
+		}
+	}
+
+	std::size_t size() const
+	{
+		return count;
+	}
+
+  private:
+	struct Slot
+	{
+		std::atomic<uint_least64_t> first_write;
+		uint16_t call_name_id;
+	};
+
+	std::atomic<bool> armed;
+	std::size_t count;
+	// sorted, index of the slot
+	std::vector<const void *> ports;
+	std::unique_ptr<Slot[]> slots;
+};
+
+} // namespace cogimon
+#endif
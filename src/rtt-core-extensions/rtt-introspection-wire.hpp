@@ -0,0 +1,75 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#ifndef RTT_INTROSPECTION_WIRE_HPP
+#define RTT_INTROSPECTION_WIRE_HPP
+
+#include <stdint.h>
+#include <type_traits>
+
+// Only depends on the standard library, so that out-of-process tools can read the records.
+
+namespace cogimon
+{
+
+/**
+ * Compact call trace sample for out_call_trace_record_port.
+ * Trivially copyable and 24 bytes, so a batch is a single contiguous allocation that is copied with memcpy.
+ * The names are resolved with the table of out_call_name_table_port (call_name_id is the index, index 0 is the container name).
+ */
+struct CallTraceRecord
+{
+	enum Flags
+	{
+		// call_duration did not fit into 32 bit (> ~4.29 s) and is clamped
+		FLAG_DURATION_SATURATED = 1,
+		// first record of each batch, call_time holds the sequence number of the batch instead of an event
+		FLAG_BATCH_SEQUENCE = 2
+	};
+
+	// ns of the RTT::os::TimeService
+	uint64_t call_time;
+	// ns, only set for CALL_START_WITH_DURATION
+	uint32_t call_duration;
+	// see RTTIntrospectionSampler
+	uint32_t sampling_factor;
+	uint16_t call_name_id;
+	// component_id attribute of the producing component
+	uint16_t component_id;
+	// rstrt::monitoring::CallTraceSample::CallType
+	uint8_t call_type;
+	uint8_t flags;
+	// nesting level of a TraceScope, 0 for the hooks and port accesses
+	uint8_t depth;
+	uint8_t reserved;
+};
+
+static_assert(sizeof(CallTraceRecord) == 24, "CallTraceRecord is part of the wire format");
+static_assert(std::is_trivially_copyable<CallTraceRecord>::value, "CallTraceRecord is part of the wire format");
+
+} // namespace cogimon
+#endif
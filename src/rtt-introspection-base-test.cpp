@@ -38,7 +38,8 @@ using namespace RTT;
 using namespace RTT::os;
 using namespace Eigen;
 
-RTTIntrospectionBaseTest::RTTIntrospectionBaseTest(const std::string &name) : RTTIntrospectionBase(name) {
+template <class TracingPolicy>
+RTTIntrospectionBaseTestT<TracingPolicy>::RTTIntrospectionBaseTestT(const std::string &name) : RTTIntrospectionTaskContext<TracingPolicy>(name) {
 	time_service = RTT::os::TimeService::Instance();
 
 	out_data = 1.337;
@@ -48,30 +49,44 @@ RTTIntrospectionBaseTest::RTTIntrospectionBaseTest(const std::string &name) : RT
     this->addPort(out_data_port);
 }
 
-bool RTTIntrospectionBaseTest::configureHookInternal() {
+template <class TracingPolicy>
+bool RTTIntrospectionBaseTestT<TracingPolicy>::configureHookInternal() {
+	out_data_trace = this->registerTracedPort(out_data_port);
+	compute_scope_id = this->registerCallName("compute");
 	return true;
 }
 
-void RTTIntrospectionBaseTest::updateHookInternal() {
+template <class TracingPolicy>
+void RTTIntrospectionBaseTestT<TracingPolicy>::updateHookInternal() {
 	RTT::os::TimeService::nsecs start = RTT::os::TimeService::ticks2nsecs(time_service->getTicks());
 
 	// while ((RTT::os::TimeService::ticks2nsecs(time_service->getTicks()) - start) < 1E+6) {
-	out_data += out_data * 1 / start;
-	this->writePort(out_data_port, out_data);
+	{
+		auto scope = this->traceScope(compute_scope_id);
+		out_data += out_data * 1 / start;
+	}
+	this->writePort(out_data_trace, out_data);
 	// }
 }
 
-bool RTTIntrospectionBaseTest::startHookInternal() {
+template <class TracingPolicy>
+bool RTTIntrospectionBaseTestT<TracingPolicy>::startHookInternal() {
 	return true;
 }
 
-void RTTIntrospectionBaseTest::stopHookInternal() {
+template <class TracingPolicy>
+void RTTIntrospectionBaseTestT<TracingPolicy>::stopHookInternal() {
 	
 }
 
-void RTTIntrospectionBaseTest::cleanupHookInternal() {
+template <class TracingPolicy>
+void RTTIntrospectionBaseTestT<TracingPolicy>::cleanupHookInternal() {
 
 }
 
+template class cogimon::RTTIntrospectionBaseTestT<CallTracingEnabled>;
+template class cogimon::RTTIntrospectionBaseTestT<CallTracingDisabled>;
+
 //ORO_CREATE_COMPONENT_LIBRARY()
 ORO_LIST_COMPONENT_TYPE(cogimon::RTTIntrospectionBaseTest)
+ORO_LIST_COMPONENT_TYPE(cogimon::RTTIntrospectionBaseTestUntraced)
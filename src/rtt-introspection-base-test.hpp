@@ -28,7 +28,7 @@
 #ifndef RTT_INTROSPECTION_BASE_TEST_HPP
 #define RTT_INTROSPECTION_BASE_TEST_HPP
 
-#include <rtt-introspection-base.hpp>
+#include <rtt-introspection-policy.hpp>
 
 #include <rtt/TaskContext.hpp>
 #include <rtt/Port.hpp>
@@ -52,10 +52,11 @@
 
 namespace cogimon {
 
-class RTTIntrospectionBaseTest : public RTTIntrospectionBase {
+template <class TracingPolicy>
+class RTTIntrospectionBaseTestT : public RTTIntrospectionTaskContext<TracingPolicy> {
 public:
-	RTTIntrospectionBaseTest(std::string const& name);
-	// virtual ~RTTIntrospectionBaseTest() {}
+	RTTIntrospectionBaseTestT(std::string const& name);
+	// virtual ~RTTIntrospectionBaseTestT() {}
 
 	bool configureHookInternal();
 	bool startHookInternal();
@@ -65,9 +66,15 @@ public:
 
 private:
 	RTT::OutputPort<double> out_data_port;
+	PortTraceHandle<RTT::OutputPort<double> > out_data_trace;
+	uint16_t compute_scope_id;
 	double out_data;
 	RTT::os::TimeService* time_service;
 };
 
+// same component code, once with and once without call tracing
+typedef RTTIntrospectionBaseTestT<CallTracingEnabled> RTTIntrospectionBaseTest;
+typedef RTTIntrospectionBaseTestT<CallTracingDisabled> RTTIntrospectionBaseTestUntraced;
+
 }
 #endif
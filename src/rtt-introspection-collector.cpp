@@ -0,0 +1,211 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#include "rtt-introspection-shm.hpp"
+
+#include <dirent.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+volatile sig_atomic_t running = 1;
+
+void stop(int)
+{
+	running = 0;
+}
+
+// one attached ring and its output file
+struct CollectedRing
+{
+	cogimon::RTTIntrospectionShmRing ring;
+	ino_t inode;
+	std::vector<std::string> names;
+	std::ofstream out;
+	uint64_t records;
+};
+
+ino_t shmInode(const std::string &object_name)
+{
+	struct stat st;
+	return stat(("/dev/shm" + object_name).c_str(), &st) == 0 ? st.st_ino : 0;
+}
+
+/**
+ * Writes the records that are available, markers are skipped.
+ */
+void collect(CollectedRing &collected, std::vector<cogimon::CallTraceRecord> &buffer)
+{
+	buffer.clear();
+	collected.ring.read(buffer);
+	static const std::string unregistered("<unregistered>");
+	const std::string container = collected.names.empty() ? unregistered : collected.names[0];
+	for (const cogimon::CallTraceRecord &record : buffer)
+	{
+		if (record.flags & cogimon::CallTraceRecord::FLAG_BATCH_SEQUENCE)
+		{
+			continue;
+		}
+		const std::string &call_name = record.call_name_id < collected.names.size() ? collected.names[record.call_name_id] : unregistered;
+		collected.out << container << "," << call_name << "," << record.call_time << "," << record.call_duration << "," << static_cast<unsigned int>(record.call_type) << "," << record.sampling_factor << "," << static_cast<unsigned int>(record.depth) << "\n";
+		collected.records++;
+	}
+}
+
+void detach(CollectedRing &collected, std::vector<cogimon::CallTraceRecord> &buffer)
+{
+	collect(collected, buffer);
+	std::cout << "Collected " << collected.records << " records of " << collected.ring.getHeader().container_name << ", " << collected.ring.getDropped() << " dropped by the ring." << std::endl;
+	collected.out.close();
+	collected.ring.close();
+}
+
+} // namespace
+
+/**
+ * Attaches to all call trace rings in /dev/shm (see RTTIntrospectionBase::useSharedMemoryTrace and CallTraceShmHeader)
+ * and writes their records to <output directory>/<pid>.<container name>.<creation time>.csv until it is interrupted.
+ * A ring that is recreated by configureHook is collected into a new file.
+ * Usage: rtt-introspection-collector [<output directory>] [<poll period in ms>]
+ */
+int main(int argc, char **argv)
+{
+	if (argc > 3)
+	{
+		std::cerr << "Usage: " << argv[0] << " [<output directory>] [<poll period in ms>]" << std::endl;
+		return 1;
+	}
+	const std::string output_directory(argc > 1 ? argv[1] : ".");
+	const int period = argc > 2 ? std::atoi(argv[2]) : 10;
+	signal(SIGINT, stop);
+	signal(SIGTERM, stop);
+
+	std::map<std::string, std::unique_ptr<CollectedRing>> rings;
+	std::vector<cogimon::CallTraceRecord> buffer;
+	const std::string prefix(cogimon::RTT_INTROSPECTION_SHM_PREFIX);
+	while (running)
+	{
+		DIR *directory = opendir("/dev/shm");
+		if (!directory)
+		{
+			std::cerr << "Could not open /dev/shm" << std::endl;
+			return 1;
+		}
+		while (struct dirent *entry = readdir(directory))
+		{
+			const std::string file_name(entry->d_name);
+			if (file_name.compare(0, prefix.size(), prefix) != 0)
+			{
+				continue;
+			}
+			const std::string object_name = "/" + file_name;
+			const ino_t inode = shmInode(object_name);
+			std::unique_ptr<CollectedRing> &collected = rings[object_name];
+			if (collected && collected->inode == inode)
+			{
+				continue;
+			}
+			if (collected)
+			{
+				// recreated by the component, the old mapping stays valid until it is drained
+				detach(*collected, buffer);
+			}
+			collected.reset(new CollectedRing());
+			if (!collected->ring.attach(object_name))
+			{
+				// not initialized yet, try again later
+				collected.reset();
+				continue;
+			}
+			collected->inode = inode;
+			collected->names = collected->ring.getNames();
+			collected->records = 0;
+			const std::string file = output_directory + "/" + file_name.substr(prefix.size()) + "." + std::to_string(collected->ring.getHeader().create_time) + ".csv";
+			collected->out.open(file.c_str());
+			collected->out << "container_name,call_name,call_time,call_duration,call_type,sampling_factor,depth\n";
+			std::cout << "Attached to " << object_name << " (pid " << collected->ring.getHeader().pid << "), writing " << file << std::endl;
+		}
+		closedir(directory);
+
+		for (std::map<std::string, std::unique_ptr<CollectedRing>>::iterator it = rings.begin(); it != rings.end();)
+		{
+			if (!it->second)
+			{
+				it = rings.erase(it);
+				continue;
+			}
+			CollectedRing &collected = *it->second;
+			if (shmInode(it->first) != collected.inode)
+			{
+				// removed by cleanupHook or recreated, the new one is attached in the next scan
+				if (collected.ring.isOpen())
+				{
+					detach(collected, buffer);
+				}
+				it = rings.erase(it);
+				continue;
+			}
+			if (collected.ring.isOpen())
+			{
+				collect(collected, buffer);
+				// the producer died without removing the ring, nobody else will remove it after it is collected
+				if (kill(collected.ring.getHeader().pid, 0) != 0 && errno == ESRCH)
+				{
+					detach(collected, buffer);
+					shm_unlink(it->first.c_str());
+				}
+			}
+			++it;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(period > 0 ? period : 1));
+	}
+
+	for (std::map<std::string, std::unique_ptr<CollectedRing>>::iterator it = rings.begin(); it != rings.end(); ++it)
+	{
+		if (it->second && it->second->ring.isOpen())
+		{
+			detach(*it->second, buffer);
+		}
+	}
+	return 0;
+}
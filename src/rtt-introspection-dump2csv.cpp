@@ -0,0 +1,88 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#include "rtt-introspection-dump.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Converts a dump of RTTIntrospectionBase::writeDebugInformation() into the CSV format (ns) it used to write directly.
+ * Usage: rtt-introspection-dump2csv <dump.bin> [<output.csv>]
+ */
+int main(int argc, char **argv)
+{
+	if (argc < 2 || argc > 3)
+	{
+		std::cerr << "Usage: " << argv[0] << " <dump.bin> [<output.csv>]" << std::endl;
+		return 1;
+	}
+	const std::string input(argv[1]);
+	std::string output;
+	if (argc == 3)
+	{
+		output = argv[2];
+	}
+	else
+	{
+		const std::size_t extension = input.rfind(".bin");
+		output = (extension != std::string::npos ? input.substr(0, extension) : input) + ".csv";
+	}
+
+	cogimon::RTTIntrospectionDumpHeader header;
+	std::vector<uint64_t> values;
+	if (!cogimon::readIntrospectionDump(input, header, values))
+	{
+		std::cerr << "Could not read " << input << std::endl;
+		return 1;
+	}
+
+	std::ofstream myfile(output.c_str());
+	if (!myfile)
+	{
+		std::cerr << "Could not write " << output << std::endl;
+		return 1;
+	}
+	bool first = true;
+	for (uint64_t value : values)
+	{
+		if (first)
+		{
+			first = false;
+		}
+		else
+		{
+			myfile << ",\n";
+		}
+		myfile << static_cast<uint64_t>(value * header.ns_per_unit);
+	}
+	myfile.close();
+	std::cout << "Converted " << values.size() << " values to " << output << std::endl;
+	return 0;
+}
@@ -0,0 +1,465 @@
+/* ============================================================
+ *
+ * This file is a part of CoSiMA (CogIMon) project
+ *
+ * Copyright (C) 2018 by Dennis Leroy Wigand <dwigand at cor-lab dot uni-bielefeld dot de>
+ *
+ * This file may be licensed under the terms of the
+ * GNU Lesser General Public License Version 3 (the ``LGPL''),
+ * or (at your option) any later version.
+ *
+ * Software distributed under the License is distributed
+ * on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+ * express or implied. See the LGPL for the specific language
+ * governing rights and limitations.
+ *
+ * You should have received a copy of the LGPL along with this
+ * program. If not, go to http://www.gnu.org/licenses/lgpl.html
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The development of this software was supported by:
+ *   European Community’s Horizon 2020 robotics program ICT-23-2014
+ *     under grant agreement 644727 - CogIMon
+ *   CoR-Lab, Research Institute for Cognition and Robotics
+ *     Bielefeld University
+ *
+ * ============================================================ */
+#include "rtt-introspection-histogram.hpp"
+#include "rtt-introspection-ring.hpp"
+#include "rtt-introspection-handover.hpp"
+#include "rtt-introspection-summary.hpp"
+#include "rtt-introspection-sampler.hpp"
+#include "rtt-introspection-mask.hpp"
+#include "rtt-introspection-batch.hpp"
+#include "rtt-introspection-memory.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cogimon;
+
+/**
+ * Self-checking tests of the real-time primitives of the introspection, which do not depend on RTT.
+ * Prints every failed check and returns the number of failures, run with ctest.
+ */
+
+static unsigned int failures = 0;
+
+static void check(const bool ok, const char *expression, const int line)
+{
+	if (!ok)
+	{
+		std::cerr << __FILE__ << ":" << line << ": check failed: " << expression << std::endl;
+		failures++;
+	}
+}
+
+#define CHECK(expression) check((expression), #expression, __LINE__)
+
+static void testHistogramBuckets()
+{
+	// the bucket of a value contains it and is at most 1/SUB_BUCKET_COUNT of it wide
+	for (uint_least64_t value = 0; value < 100000; value++)
+	{
+		const std::size_t index = RTTIntrospectionHistogram::bucketIndex(value);
+		const uint_least64_t upper = RTTIntrospectionHistogram::bucketUpperBound(index);
+		if (index >= RTTIntrospectionHistogram::BUCKET_COUNT || upper < value || upper - value > value / RTTIntrospectionHistogram::SUB_BUCKET_COUNT)
+		{
+			CHECK(false);
+			return;
+		}
+	}
+	CHECK(RTTIntrospectionHistogram::bucketIndex(31) == 31);
+	CHECK(RTTIntrospectionHistogram::bucketIndex(32) == 32);
+	CHECK(RTTIntrospectionHistogram::bucketUpperBound(RTTIntrospectionHistogram::bucketIndex(1000)) == 1007);
+	CHECK(RTTIntrospectionHistogram::bucketIndex(UINT64_MAX) == RTTIntrospectionHistogram::BUCKET_COUNT - 1);
+	CHECK(RTTIntrospectionHistogram::bucketUpperBound(RTTIntrospectionHistogram::BUCKET_COUNT - 1) == UINT64_MAX);
+}
+
+static void testHistogramPercentiles()
+{
+	RTTIntrospectionHistogram histogram;
+	CHECK(histogram.getPercentile(50.0) == 0);
+	for (uint_least64_t value = 1; value <= 1000; value++)
+	{
+		histogram.record(value);
+	}
+	CHECK(histogram.getCount() == 1000);
+	CHECK(histogram.getMax() == 1000);
+	const uint_least64_t p50 = histogram.getPercentile(50.0);
+	const uint_least64_t p99 = histogram.getPercentile(99.0);
+	CHECK(p50 >= 500 && p50 <= 500 + 500 / RTTIntrospectionHistogram::SUB_BUCKET_COUNT);
+	CHECK(p99 >= 990 && p99 <= 1000);
+	// never above the largest recorded value
+	CHECK(histogram.getPercentile(100.0) == 1000);
+	histogram.reset();
+	CHECK(histogram.getCount() == 0 && histogram.getMax() == 0);
+}
+
+static void testRingFullAndEmpty()
+{
+	RTTIntrospectionRing<int> ring;
+	CHECK(!ring.push(1));
+	CHECK(ring.front() == 0);
+	// rounded up to a power of two
+	ring.resize(3, 0);
+	CHECK(ring.capacity() == 4);
+	CHECK(ring.front() == 0);
+	for (int i = 0; i < 4; i++)
+	{
+		CHECK(ring.push(i));
+	}
+	CHECK(!ring.push(4));
+	CHECK(ring.size() == 4);
+	// in order, and across the wrap-around
+	for (int i = 0; i < 10; i++)
+	{
+		int *element = ring.front();
+		CHECK(element && *element == i);
+		ring.pop();
+		CHECK(ring.push(i + 4));
+	}
+	CHECK(ring.size() == 4);
+	while (ring.front())
+	{
+		ring.pop();
+	}
+	CHECK(ring.size() == 0);
+}
+
+static void testRingThreads()
+{
+	static const int count = 1000000;
+	RTTIntrospectionRing<int> ring;
+	ring.resize(64, 0);
+	std::thread producer([&ring]() {
+		for (int i = 0; i < count; i++)
+		{
+			while (!ring.push(i))
+			{
+				std::this_thread::yield();
+			}
+		}
+	});
+	int expected = 0;
+	bool ordered = true;
+	while (expected < count)
+	{
+		int *element = ring.front();
+		if (!element)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		ordered = ordered && *element == expected;
+		ring.pop();
+		expected++;
+	}
+	producer.join();
+	CHECK(ordered);
+	CHECK(ring.front() == 0);
+}
+
+struct HandoverObject
+{
+	HandoverObject() : a(0), b(0)
+	{
+		live++;
+	}
+
+	~HandoverObject()
+	{
+		live--;
+	}
+
+	int a;
+	int b;
+	static int live;
+};
+
+int HandoverObject::live = 0;
+
+static void testHandover()
+{
+	{
+		RTTIntrospectionHandover<HandoverObject> handover;
+		CHECK(!handover.isPending());
+		CHECK(handover.take() == 0);
+
+		// the second update merges into the object that was not taken yet
+		handover.update([](HandoverObject &object) { object.a = 1; });
+		handover.update([](HandoverObject &object) { object.b = 2; });
+		CHECK(HandoverObject::live == 1);
+		HandoverObject *taken = handover.take();
+		CHECK(taken && taken->a == 1 && taken->b == 2);
+		CHECK(handover.take() == 0);
+
+		// retired objects are freed by the next update, not by the reader
+		handover.retire(taken);
+		CHECK(HandoverObject::live == 1);
+		handover.update([](HandoverObject &object) { object.a = 3; });
+		CHECK(HandoverObject::live == 1);
+
+		// without room to retire, the reader does not take anything
+		for (int i = 0; i < 4; i++)
+		{
+			handover.retire(new HandoverObject());
+		}
+		CHECK(handover.take() == 0);
+		CHECK(handover.isPending());
+		handover.update([](HandoverObject &object) { object.b = 4; });
+		CHECK(HandoverObject::live == 1);
+		taken = handover.take();
+		CHECK(taken && taken->a == 3 && taken->b == 4);
+		handover.retire(taken);
+		handover.update([](HandoverObject &object) { object.a = 5; });
+	}
+	// the destructor frees the pending and the retired objects
+	CHECK(HandoverObject::live == 0);
+}
+
+static CallTraceEvent summaryEvent(const uint16_t call_name_id, const uint8_t call_type, const uint_least64_t start, const uint_least64_t end, const uint32_t sampling_factor)
+{
+	CallTraceEvent cte;
+	cte.call_name_id = call_name_id;
+	cte.call_type = call_type;
+	cte.call_time = start;
+	cte.call_duration = end;
+	cte.sampling_factor = sampling_factor;
+	return cte;
+}
+
+static void testSummaryRotateAndConsume()
+{
+	RTTIntrospectionSummary summary;
+	summary.configure(4, 100, 0);
+	summary.add(summaryEvent(1, rstrt::monitoring::CallTraceSample::CALL_PORT_WRITE, 5, 0, 1));
+	summary.add(summaryEvent(1, rstrt::monitoring::CallTraceSample::CALL_PORT_WRITE, 6, 0, 1));
+	summary.add(summaryEvent(2, rstrt::monitoring::CallTraceSample::CALL_START_WITH_DURATION, 10, 30, 2));
+	summary.add(summaryEvent(3, rstrt::monitoring::CallTraceSample::CALL_PORT_READ_NEWDATA, 40, 0, 1));
+	// unknown ids are ignored
+	summary.add(summaryEvent(7, rstrt::monitoring::CallTraceSample::CALL_PORT_WRITE, 40, 0, 1));
+
+	unsigned int entries = 0;
+	CHECK(!summary.consume([&entries](const uint16_t, const RTTIntrospectionSummary::Entry &, const uint_least64_t, const uint_least64_t) { entries++; }));
+	CHECK(!summary.rotate(50));
+	CHECK(summary.rotate(100));
+	// the consumer is behind, so the interval is extended
+	summary.add(summaryEvent(1, rstrt::monitoring::CallTraceSample::CALL_PORT_WRITE, 120, 0, 1));
+	CHECK(!summary.rotate(200));
+
+	bool consumed_ok = true;
+	CHECK(summary.consume([&entries, &consumed_ok](const uint16_t id, const RTTIntrospectionSummary::Entry &entry, const uint_least64_t start, const uint_least64_t end) {
+		entries++;
+		consumed_ok = consumed_ok && start == 0 && end == 100;
+		if (id == 1)
+		{
+			consumed_ok = consumed_ok && entry.calls == 2 && entry.writes == 2 && entry.durations == 0;
+		}
+		else if (id == 2)
+		{
+			// weighted with the sampling factor
+			consumed_ok = consumed_ok && entry.calls == 2 && entry.durations == 2 && entry.duration_sum == 40 && entry.duration_min == 20 && entry.duration_max == 20;
+		}
+		else if (id == 3)
+		{
+			consumed_ok = consumed_ok && entry.calls == 1 && entry.reads_new_data == 1;
+		}
+		else
+		{
+			consumed_ok = false;
+		}
+	}));
+	CHECK(consumed_ok);
+	CHECK(entries == 3);
+	CHECK(!summary.consume([](const uint16_t, const RTTIntrospectionSummary::Entry &, const uint_least64_t, const uint_least64_t) {}));
+
+	CHECK(summary.rotate(250));
+	entries = 0;
+	consumed_ok = true;
+	CHECK(summary.consume([&entries, &consumed_ok](const uint16_t id, const RTTIntrospectionSummary::Entry &entry, const uint_least64_t start, const uint_least64_t end) {
+		entries++;
+		consumed_ok = consumed_ok && id == 1 && entry.calls == 1 && start == 100 && end == 250;
+	}));
+	CHECK(consumed_ok);
+	CHECK(entries == 1);
+	// the consumed bank is empty again
+	for (unsigned int bank = 0; bank < 2; bank++)
+	{
+		for (const RTTIntrospectionSummary::Entry &entry : summary.getEntries(bank))
+		{
+			CHECK(entry.calls == 0);
+		}
+	}
+}
+
+static void testSampler()
+{
+	RTTIntrospectionSampler sampler;
+	sampler.configure(1000);
+	CHECK(sampler.sampleCycle(0, 0) && sampler.getFactor() == 1);
+
+	sampler.mode = RTTIntrospectionSampler::SAMPLING_INTERVAL;
+	sampler.interval = 4;
+	unsigned int sampled = 0;
+	for (unsigned int i = 0; i < 400; i++)
+	{
+		sampled += sampler.sampleCycle(i, 0) ? 1 : 0;
+	}
+	CHECK(sampled == 100);
+	CHECK(sampler.getFactor() == 4);
+
+	sampler.mode = RTTIntrospectionSampler::SAMPLING_RANDOM;
+	sampler.probability = 0.25;
+	CHECK(sampler.configure(1000));
+	sampled = 0;
+	for (unsigned int i = 0; i < 100000; i++)
+	{
+		sampled += sampler.sampleCycle(i, 0) ? 1 : 0;
+	}
+	CHECK(sampled > 24000 && sampled < 26000);
+	CHECK(sampler.getFactor() == 4);
+
+	// probabilities that are not 1/N are rounded, so that the factor stays exact
+	sampler.probability = 0.4;
+	CHECK(!sampler.configure(1000));
+	sampler.sampleCycle(0, 0);
+	CHECK(sampler.getFactor() == 3 && sampler.probability == 1.0 / 3.0);
+	sampler.probability = 2.0;
+	CHECK(!sampler.configure(1000));
+	sampler.sampleCycle(0, 0);
+	CHECK(sampler.getFactor() == 1 && sampler.probability == 1.0);
+	sampler.probability = 0.0;
+	CHECK(!sampler.configure(1000));
+	sampler.sampleCycle(0, 0);
+	CHECK(sampler.getFactor() == RTTIntrospectionSampler::MAX_INTERVAL);
+
+	// 10 events per cycle, 100 cycles per second (1000 ticks): 1000 events/s for a budget of 100
+	sampler.mode = RTTIntrospectionSampler::SAMPLING_ADAPTIVE;
+	sampler.event_budget = 100.0;
+	sampler.configure(1000);
+	uint_least64_t stored = 0;
+	for (uint_least64_t now = 1; now < 10000; now += 10)
+	{
+		if (sampler.sampleCycle(now, stored))
+		{
+			stored += 10;
+		}
+	}
+	CHECK(sampler.getFactor() == 10);
+}
+
+static void testTraceMask()
+{
+	std::vector<std::string> names;
+	names.push_back("updateHook()");
+	names.push_back("robot_in");
+	names.push_back("robot_out");
+	RTTIntrospectionTraceMask mask;
+	mask.resize(names.size());
+	CHECK(mask.isEnabled(0) && mask.isEnabled(1) && mask.isEnabled(2));
+	CHECK(mask.select(names, "robot_*", false) == 2);
+	// picked up at the start of the next cycle only
+	CHECK(mask.isEnabled(1));
+	mask.update();
+	CHECK(mask.isEnabled(0) && !mask.isEnabled(1) && !mask.isEnabled(2));
+	// registered after resize()
+	CHECK(mask.isEnabled(100));
+	CHECK(mask.getEnabled(names).size() == 1);
+	CHECK(mask.select(names, "nothing", false) == 0);
+
+	// the reader never sees half of a selection
+	std::atomic<bool> writing(true);
+	std::thread writer([&mask, &names, &writing]() {
+		for (unsigned int i = 0; i <= 20000; i++)
+		{
+			mask.select(names, "robot_*", (i & 1) != 0);
+		}
+		writing = false;
+	});
+	bool consistent = true;
+	while (writing.load())
+	{
+		mask.update();
+		consistent = consistent && mask.isEnabled(1) == mask.isEnabled(2);
+	}
+	writer.join();
+	mask.update();
+	CHECK(consistent);
+	CHECK(!mask.isEnabled(1) && !mask.isEnabled(2));
+}
+
+static void testBatchTuner()
+{
+	// 1 tick = 1 us, 0.1 ticks of flush budget per updateHook
+	RTTIntrospectionBatchTuner tuner;
+	tuner.configure(1000.0, 1, 256, 8);
+	CHECK(tuner.getBatchSize() == 256);
+	CHECK(tuner.getMaxAge() == 100000);
+
+	// one event per cycle at a flush cost of one tick: at least 10 events per block, twice that for headroom
+	tuner.update(10, 10, 1000, 1.0);
+	CHECK(tuner.getBatchSize() == 20);
+	CHECK(tuner.getMaxAge() == 100000);
+
+	// the budget can not be met with the preallocated blocks
+	tuner.update(10, 10, 1000, 1000.0);
+	CHECK(tuner.getBatchSize() == 256);
+
+	// without a budget the smallest batch is used
+	tuner.flush_budget = 0;
+	tuner.configure(1000.0, 1, 256, 8);
+	tuner.update(10, 10, 1000, 1.0);
+	CHECK(tuner.getBatchSize() == 1);
+
+	// a slow consumer keeps half of the pool free with larger blocks
+	tuner.observeDrainLatency(2000);
+	tuner.update(10, 10, 1000, 1.0);
+	CHECK(tuner.getBatchSize() == 10);
+}
+
+static void testMemoryLock()
+{
+	const std::size_t page = RTTIntrospectionPageAllocator<char>::pageSize();
+	RTTIntrospectionMemoryLock memory;
+	// a page that is shared with other allocations is only prefaulted
+	std::vector<char> shared(page / 2);
+	CHECK(memory.lock(shared));
+	CHECK(memory.getLocked() == 0);
+	CHECK(memory.getPrefaulted() > 0);
+
+	std::vector<char, RTTIntrospectionPageAllocator<char>> dedicated(page + 1);
+	CHECK(reinterpret_cast<uintptr_t>(dedicated.data()) % page == 0);
+	memory.unlock();
+	const bool locked = memory.lock(dedicated);
+	CHECK(memory.getPrefaulted() == 2 * page);
+	// RLIMIT_MEMLOCK may be too small
+	CHECK(locked ? memory.getLocked() == 2 * page : memory.getError() != 0);
+	memory.unlock();
+	CHECK(memory.getLocked() == 0);
+}
+
+int main()
+{
+	testHistogramBuckets();
+	testHistogramPercentiles();
+	testRingFullAndEmpty();
+	testRingThreads();
+	testHandover();
+	testSummaryRotateAndConsume();
+	testSampler();
+	testTraceMask();
+	testBatchTuner();
+	testMemoryLock();
+	if (failures > 0)
+	{
+		std::cerr << failures << " checks failed." << std::endl;
+		return 1;
+	}
+	std::cout << "All checks passed." << std::endl;
+	return 0;
+}